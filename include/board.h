@@ -0,0 +1,78 @@
+/*
+ * Capa mínima de placa (HAL). Aísla lo que cambia entre el Uno y las placas
+ * con más recursos:
+ *   - el puerto UART hacia el EZO (SoftwareSerial en el Uno, UART hardware
+ *     en ESP32/RP2040),
+ *   - la EEPROM emulada en flash, que necesita begin()/commit(),
+ *   - una tarea de adquisición aparte de la CLI: en ESP32 una tarea de
+ *     FreeRTOS en el núcleo 0, en RP2040 el segundo núcleo (loop1()).
+ * En el Uno todo corre en loop() y el cerrojo no hace nada.
+ */
+#pragma once
+#include <Arduino.h>
+
+// Transporte hacia el EZO: UART (por defecto) o I2C con -DEZO_TRANSPORT_I2C=1
+#ifndef EZO_TRANSPORT_I2C
+#define EZO_TRANSPORT_I2C 0
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_RP2040)
+#define BOARD_TASKS 1
+#else
+#define BOARD_TASKS 0
+#endif
+
+// Pines del UART hacia el EZO (RX de la placa ← TX del EZO)
+#ifndef EZO_UART_RX
+#if defined(ARDUINO_ARCH_ESP32)
+#define EZO_UART_RX 16   // UART2
+#define EZO_UART_TX 17
+#elif defined(ARDUINO_ARCH_RP2040)
+#define EZO_UART_RX 1    // UART0: GP1
+#define EZO_UART_TX 0    //        GP0
+#else
+#define EZO_UART_RX 3    // D3 (SoftwareSerial)
+#define EZO_UART_TX 2    // D2
+#endif
+#endif
+
+// Puerto serie del EZO, ya como Stream para EzoUartTransport (solo con
+// transporte UART: en el Uno no se reserva SoftwareSerial si va por I2C)
+Stream& boardEzoSerial();
+void boardEzoSerialBegin(unsigned long baud);
+// El buffer RX se desbordó desde la última consulta (false si la placa no lo sabe)
+bool boardEzoSerialOverflow();
+
+// EEPROM: en flash emulada hay que reservarla y confirmar las escrituras
+void boardEepromBegin();
+void boardEepromCommit();
+
+// RAM libre mínima desde el arranque, en bytes. En AVR, boardRamPaint() (al
+// principio de setup()) rellena el hueco entre heap y pila con un patrón, y
+// boardFreeRamMin() cuenta cuánto queda sin pisar: recorre ~1 KB, así que
+// solo para "perf"/"bench", no por iteración. ESP32: mínimo del heap;
+// RP2040: heap libre actual (el core no guarda el mínimo).
+void boardRamPaint();
+uint32_t boardFreeRamMin();
+
+// Arranca fn en bucle en su propia tarea/núcleo. Devuelve false si la placa
+// no tiene tareas: entonces hay que llamarla desde loop().
+bool boardStartTask(void (*fn)());
+
+// Exclusión entre la tarea de adquisición y la CLI, que comparten el estado
+// de las sondas y Serial
+#if BOARD_TASKS
+void boardLock();
+void boardUnlock();
+#else
+inline void boardLock() {}
+inline void boardUnlock() {}
+#endif
+
+class BoardLock {
+ public:
+  BoardLock() { boardLock(); }
+  ~BoardLock() { boardUnlock(); }
+  BoardLock(const BoardLock&) = delete;
+  BoardLock& operator=(const BoardLock&) = delete;
+};
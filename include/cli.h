@@ -0,0 +1,86 @@
+/*
+ * CLI por tabla: los comandos se describen en una tabla PROGMEM (nombre,
+ * uso, nº de argumentos y manejador) y la línea se trocea en su sitio sobre
+ * un buffer fijo, sin String ni heap.
+ */
+#pragma once
+#include <Arduino.h>
+
+#ifndef CLI_LINE_MAX
+#define CLI_LINE_MAX 48
+#endif
+
+static const uint8_t CLI_MAX_ARGS = 4;   // sin contar el nombre del comando
+
+// argv[0] es el nombre del comando; argc lo incluye
+typedef void (*CliHandler)(uint8_t argc, char** argv);
+
+struct CliCommand {
+  const char* name;     // PROGMEM
+  const char* usage;    // PROGMEM, se muestra si los argumentos no encajan
+  uint8_t minArgs;
+  uint8_t maxArgs;
+  CliHandler handler;
+};
+
+enum CliResult : uint8_t { CLI_OK, CLI_EMPTY, CLI_UNKNOWN, CLI_USAGE };
+
+// Separa line por espacios en su sitio. Devuelve el nº de tokens, que puede
+// ser maxTokens + 1 si sobraban (solo se guardan maxTokens).
+uint8_t cliTokenize(char* line, char** argv, uint8_t maxTokens);
+
+// Busca argv[0] en la tabla (sin distinguir mayúsculas) y llama al manejador.
+// Los errores de uso y los comandos desconocidos se informan por out.
+CliResult cliDispatch(const CliCommand* table, uint8_t count, char* line, Print& out);
+
+// Compara un argumento con un literal PROGMEM sin distinguir mayúsculas
+inline bool cliIs(const char* arg, const char* literalP) { return strcasecmp_P(arg, literalP) == 0; }
+
+// Acumula bytes de la terminal hasta CR/LF, o hasta ~300 ms sin bytes
+// (para "Line ending: None" en el monitor serie)
+class CliLineBuffer {
+ public:
+  CliLineBuffer() { clear(); }
+
+  // Devuelve la línea lista (válida hasta el siguiente poll) o nullptr
+  char* poll(Stream& in, unsigned long nowMs);
+
+  // La última línea devuelta excedía CLI_LINE_MAX y se recortó
+  bool overflowed() const { return overflowed_; }
+
+ private:
+  void clear() { len_ = 0; buf_[0] = '\0'; overflow_ = false; }
+
+  char buf_[CLI_LINE_MAX + 1];
+  uint8_t len_;
+  bool overflow_;
+  bool overflowed_ = false;
+  bool ready_ = false;
+  unsigned long lastByteMs_ = 0;
+};
+
+#ifndef CLI_BATCH_MAX
+#define CLI_BATCH_MAX 128   // bytes para el guion del modo batch (máx. 255)
+#endif
+
+// Guion del modo batch: líneas guardadas una tras otra (terminadas en '\0')
+// y devueltas en orden por next()
+class CliBatch {
+ public:
+  void clear() { len_ = pos_ = count_ = 0; }
+
+  // Añade line; cada ';' la divide en otra línea. false si no cabe entera
+  // (en ese caso no se añade nada)
+  bool append(const char* line);
+
+  // Siguiente línea, que se puede trocear en su sitio, o nullptr al final
+  char* next();
+
+  uint8_t count() const { return count_; }
+
+ private:
+  char buf_[CLI_BATCH_MAX];
+  uint8_t len_ = 0;
+  uint8_t pos_ = 0;
+  uint8_t count_ = 0;
+};
@@ -0,0 +1,44 @@
+/*
+ * Configuración persistente en EEPROM con cabecera de versión y CRC.
+ * Guarda los ajustes de la CLI y la última máscara de salidas conocida del
+ * EZO para no tener que reconfigurarlo entero en cada arranque.
+ */
+#pragma once
+#include <stdint.h>
+
+// Cambiar CONFIG_VERSION si cambia la estructura: la copia vieja se ignora
+static const uint8_t CONFIG_VERSION = 8;
+
+// Sondas EZO que caben en la configuración (y en el nibble de sonda de ec_frame.h)
+#ifndef EZO_PROBE_MAX
+#define EZO_PROBE_MAX 4
+#endif
+
+struct Settings {
+  uint8_t streamMask;      // bit i: streaming activo en la sonda i
+  uint32_t readPeriodMs;
+  uint8_t printRaw;
+  uint8_t outFormat;
+  uint8_t sampleFields;    // columnas de texto/csv (SAMPLE_FIELDS, "derive")
+  uint8_t logLevel;
+  uint8_t ezoOutputMask[EZO_PROBE_MAX];   // EC_FIELD_* habilitados en cada EZO
+  uint8_t tempAuto;                       // compensación con el sensor local
+  uint16_t tempDeadbandCenti;             // banda muerta para reenviar T (0.01 °C)
+  uint8_t filterMode;                     // EcFilterMode
+  uint8_t filterLen;
+  uint8_t decimation;
+  int32_t deltaMilli;                     // stream delta: umbral de EC (0 = todas)
+  uint16_t heartbeatS;                    // stream delta: muestra forzada cada n s
+  uint16_t dutyPeriodS;                   // ciclo de bajo consumo (0 = desactivado)
+  uint8_t dutyReadings;                   // lecturas por ciclo
+  uint8_t netBatch;                       // muestras por paquete de red
+  uint8_t netFormat;                      // SinkFormat
+  uint32_t netFlushMs;                    // envío de un lote incompleto
+};
+
+// Devuelve false (y deja out intacto) si no hay copia válida
+bool settingsLoad(Settings& out);
+// No escribe nada si coincide con lo guardado. Si hay cambios, en AVR put()
+// solo reescribe los bytes distintos (EEPROM.update); en flash emulada
+// (ESP32/RP2040) commit() reescribe el sector entero
+void settingsSave(const Settings& in);
@@ -0,0 +1,16 @@
+/*
+ * CRC-8 (polinomio 0x07, init 0), usado por los registros binarios y la
+ * configuración en EEPROM.
+ */
+#pragma once
+#include <stdint.h>
+
+inline uint8_t crc8(const uint8_t* d, uint16_t n, uint8_t crc = 0) {
+  while (n--) {
+    crc ^= *d++;
+    for (uint8_t i = 0; i < 8; i++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,31 @@
+/*
+ * Magnitudes derivadas de la EC, calculadas en la placa en vez de pedirle
+ * al EZO "O,TDS/S/SG" (que alarga cada línea de respuesta). Todo en enteros
+ * sobre milésimas (ecToMilli): la salinidad PSS-78 sale de una tabla en
+ * PROGMEM precalculada a 25 °C con interpolación lineal por tramos, así que
+ * en el AVR no hay polinomios ni soft-float.
+ * La EC de entrada es la que da el EZO, ya referida a 25 °C si se le envía
+ * la temperatura (T,x o RT); por eso la tabla no depende de t.
+ */
+#pragma once
+#include <stdint.h>
+
+// Punto de una tabla: x en µS/cm, y en milésimas de la magnitud
+struct EcLutPoint {
+  uint16_t x;
+  uint16_t y;
+};
+
+// Interpolación lineal en una tabla PROGMEM de n puntos con x creciente;
+// fuera de rango se extrapola con el tramo extremo (y >= 0)
+int32_t ecLutInterp(const EcLutPoint* table, uint8_t n, int32_t xMilli);
+
+// Salinidad práctica (PSS-78, con la extensión de Hill para S < 2) en
+// milésimas de PSU, a partir de la EC a 25 °C. Error de la tabla < 0.02 PSU
+// hasta 60 mS/cm; por encima se extrapola.
+int32_t ecSalinityMilli(int32_t ecMilli);
+
+// Resistividad en milésimas de MΩ·cm (1/EC). Agua ultrapura a 25 °C: 18.18.
+// Con EC <= 0 devuelve EC_RES_OPEN.
+static const int32_t EC_RES_OPEN = INT32_MAX;
+int32_t ecResistivityMilli(int32_t ecMilli);
@@ -0,0 +1,51 @@
+/*
+ * Filtro digital y decimación de las lecturas de EC, en enteros sobre las
+ * milésimas (ecToMilli) y con una ventana fija pequeña. Media móvil,
+ * mediana de N o EWMA; con decimación D solo sale una muestra filtrada por
+ * cada D lecturas del EZO. No depende de Arduino.h (se prueba en native).
+ */
+#pragma once
+#include <stdint.h>
+
+#ifndef EC_FILTER_MAX
+#define EC_FILTER_MAX 16   // ventana máxima de media y mediana
+#endif
+
+enum EcFilterMode : uint8_t {
+  EC_FILTER_OFF = 0,
+  EC_FILTER_MEAN,      // media de las últimas n
+  EC_FILTER_MEDIAN,    // mediana de las últimas n (robusta a picos)
+  EC_FILTER_EWMA,      // y += (x - y) / n
+};
+
+class EcFilter {
+ public:
+  // n se acota a 1..EC_FILTER_MAX (EWMA admite hasta 255); decim 0 cuenta como 1.
+  // Reinicia el estado.
+  void configure(EcFilterMode mode, uint8_t n, uint8_t decim);
+  void reset();
+
+  // Añade una lectura (milésimas). Devuelve true si toca emitir una muestra,
+  // con el valor filtrado en out; false si la lectura solo se acumula.
+  bool push(int32_t milli, int32_t& out);
+
+  EcFilterMode mode() const { return mode_; }
+  uint8_t length() const { return n_; }
+  uint8_t decimation() const { return decim_; }
+  // Sin filtro ni decimación push() devuelve siempre la lectura tal cual
+  bool active() const { return mode_ != EC_FILTER_OFF || decim_ > 1; }
+
+ private:
+  int32_t mean() const;
+  int32_t median() const;
+
+  int32_t ring_[EC_FILTER_MAX];
+  uint8_t head_ = 0;     // posición de la próxima escritura
+  uint8_t count_ = 0;
+  uint8_t phase_ = 0;    // lecturas desde la última emisión
+  EcFilterMode mode_ = EC_FILTER_OFF;
+  uint8_t n_ = 1;
+  uint8_t decim_ = 1;
+  bool primed_ = false;  // EWMA ya tiene valor inicial
+  int32_t ewma_ = 0;
+};
@@ -0,0 +1,37 @@
+/*
+ * Registro binario por muestra para el enlace USB (fmt bin).
+ * 15 bytes, little-endian:
+ *   [0]      0xA7 sincronía (0xA5 era la versión de 13 bytes, sin RTT)
+ *   [1..2]   secuencia (uint16, una por muestra emitida)
+ *   [3..6]   millis() del envío del R que produjo la muestra (uint32)
+ *   [7..10]  EC en milli-µS/cm (int32)
+ *   [11..12] ms entre el envío y la respuesta (uint16; 0 = desconocido,
+ *            p. ej. modo continuo o volcado del buffer)
+ *   [13]     bits 0..3: campos presentes (EC_FIELD_*), bits 4..7: sonda
+ *   [14]     CRC-8 (polinomio 0x07, init 0) de los bytes 1..13
+ * No depende de Arduino.h para que las herramientas del host lo reutilicen.
+ */
+#pragma once
+#include <stdint.h>
+#include "crc8.h"
+
+static const uint8_t EC_FRAME_SYNC = 0xA7;
+static const uint8_t EC_FRAME_LEN = 15;
+
+inline void putLe(uint8_t* p, uint32_t v, uint8_t n) {
+  for (uint8_t i = 0; i < n; i++) { p[i] = (uint8_t)v; v >>= 8; }
+}
+
+inline uint8_t ecFrameFlags(uint8_t fields, uint8_t probe) {
+  return (uint8_t)((fields & 0x0F) | (probe << 4));
+}
+
+inline void ecFrameEncode(uint8_t* out, uint16_t seq, uint32_t ms, int32_t ecMilli, uint16_t rttMs, uint8_t flags) {
+  out[0] = EC_FRAME_SYNC;
+  putLe(out + 1, seq, 2);
+  putLe(out + 3, ms, 4);
+  putLe(out + 7, (uint32_t)ecMilli, 4);
+  putLe(out + 11, rttMs, 2);
+  out[13] = flags;
+  out[14] = crc8(out + 1, EC_FRAME_LEN - 2);
+}
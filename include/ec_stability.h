@@ -0,0 +1,45 @@
+/*
+ * Detector de lectura estable para la calibración guiada: ventana de las
+ * últimas n lecturas (milésimas) con la deriva por mínimos cuadrados a lo
+ * largo de la ventana y la desviación típica. Es estable cuando la ventana
+ * está llena y ambas quedan bajo la tolerancia, relativa al valor medio
+ * (‰) con un mínimo absoluto para lecturas cercanas a 0 (calibración en
+ * seco). No depende de Arduino.h (se prueba en native).
+ */
+#pragma once
+#include <stdint.h>
+
+#ifndef EC_STABLE_MAX
+#define EC_STABLE_MAX 16   // ventana máxima
+#endif
+
+class EcStability {
+ public:
+  // n se acota a 3..EC_STABLE_MAX. Tolerancia = max(media·permille/1000,
+  // floorMilli). Reinicia la ventana.
+  void configure(uint8_t n, uint16_t permille, int32_t floorMilli);
+  void reset() { head_ = count_ = 0; }
+
+  // Añade una lectura; devuelve true si la ventana ya es estable
+  bool push(int32_t milli);
+
+  uint8_t count() const { return count_; }
+  uint8_t length() const { return n_; }
+  // Valores de la última evaluación, para mostrar el progreso
+  int32_t meanMilli() const { return mean_; }
+  int32_t driftMilli() const { return drift_; }     // pendiente × (n - 1)
+  int32_t sigmaMilli() const { return sigma_; }
+  int32_t toleranceMilli() const { return tol_; }
+
+ private:
+  int32_t ring_[EC_STABLE_MAX];
+  uint8_t head_ = 0;
+  uint8_t count_ = 0;
+  uint8_t n_ = 10;
+  uint16_t permille_ = 5;
+  int32_t floor_ = 1000;
+  int32_t mean_ = 0;
+  int32_t drift_ = 0;
+  int32_t sigma_ = 0;
+  int32_t tol_ = 0;
+};
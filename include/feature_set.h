@@ -0,0 +1,56 @@
+/*
+ * Funciones fijadas en compilación, seleccionables por env de platformio.ini
+ * con -D (valores por defecto: todo activo, como hasta ahora).
+ * Features expone cada opción como constexpr; el código las consulta con
+ * if (Features::...) en vez de #if, así las ramas desactivadas se siguen
+ * comprobando al compilar pero el optimizador las elimina junto con sus
+ * cadenas F(), igual que LOG_ENABLED() en log.h.
+ * Aritmética (EC_FIXED_POINT, ec_value.h) y transporte (EZO_TRANSPORT_I2C,
+ * board.h) ya eran de compilación y siguen en sus cabeceras.
+ */
+#pragma once
+#include <stdint.h>
+
+// Formatos de muestra que admite "fmt": bits OUT_FMT_*
+#define OUT_FMT_TEXT 0x01
+#define OUT_FMT_BIN  0x02
+#define OUT_FMT_CSV  0x04
+#ifndef OUT_FORMATS
+#define OUT_FORMATS (OUT_FMT_TEXT | OUT_FMT_BIN | OUT_FMT_CSV)
+#endif
+
+// Columnas de las muestras en texto/csv que existen en el binario, en bits
+// EC_FIELD_* (ezo_parse.h) más SAMPLE_FIELD_RES: 0x01 EC (siempre), 0x02
+// TDS≈, 0x04 SAL (PSS-78), 0x08 SG, 0x10 resistividad. En ejecución se
+// eligen con "derive" (tds/sal/res) y "o sg". No cambia lo que envía el
+// EZO ni el registro binario, que solo lleva EC.
+#define SAMPLE_FIELD_RES 0x10
+#ifndef SAMPLE_FIELDS
+#define SAMPLE_FIELDS 0x1F
+#endif
+
+// Conversión EC (µS/cm) → TDS (ppm), como fracción entera num/den para que
+// el modo punto fijo no necesite soft-float (ver ec_value.h). La salinidad
+// ya no es un factor lineal: sale de la tabla PSS-78 de ec_derived.h.
+#ifndef TDS_PPM_NUM
+#define TDS_PPM_NUM 5      // 0.5: usa 7/10 si prefieres escala 700
+#define TDS_PPM_DEN 10
+#endif
+
+struct Features {
+  static constexpr uint8_t formats = OUT_FORMATS;
+  static constexpr uint8_t fields = (SAMPLE_FIELDS) | 0x01;
+  static constexpr uint16_t tdsNum = TDS_PPM_NUM;
+  static constexpr uint32_t tdsDen = TDS_PPM_DEN;
+
+  // f es el índice del formato (OutFormat en main.cpp: 0 text, 1 bin, 2 csv)
+  static constexpr bool format(uint8_t f) { return (formats >> f) & 1; }
+  static constexpr bool field(uint8_t bit) { return (fields & bit) != 0; }
+  // Primer formato disponible: el de arranque si no hay ajustes guardados
+  static constexpr uint8_t defaultFormat() {
+    return (formats & OUT_FMT_TEXT) ? 0 : (formats & OUT_FMT_BIN) ? 1 : 2;
+  }
+};
+
+static_assert((OUT_FORMATS & 0x07) != 0, "OUT_FORMATS: hace falta al menos un formato");
+static_assert(TDS_PPM_DEN != 0, "factor TDS con denominador 0");
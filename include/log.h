@@ -0,0 +1,22 @@
+/*
+ * Niveles de log para los mensajes de diagnóstico por Serial.
+ * logLevel se cambia en tiempo de ejecución (comando "log"); LOG_LEVEL_MAX
+ * fija en compilación el nivel más detallado que existe en el binario.
+ * Como LOG_ENABLED() es constante para niveles > LOG_LEVEL_MAX, el
+ * compilador elimina esas ramas y sus cadenas F() de la flash.
+ */
+#pragma once
+#include <stdint.h>
+
+#define LOG_OFF   0
+#define LOG_ERR   1
+#define LOG_INFO  2
+#define LOG_DEBUG 3
+
+#ifndef LOG_LEVEL_MAX
+#define LOG_LEVEL_MAX LOG_DEBUG
+#endif
+
+extern uint8_t logLevel;
+
+#define LOG_ENABLED(lvl) ((lvl) <= LOG_LEVEL_MAX && (lvl) <= logLevel)
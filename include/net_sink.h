@@ -0,0 +1,40 @@
+/*
+ * Destinos de red para las muestras en placas con WiFi (ESP32, Pico W).
+ * Se elige al compilar con -DNET_SINK=1 (UDP) o 2 (MQTT, con PubSubClient)
+ * y se configura con WIFI_SSID, WIFI_PASS, NET_HOST y NET_PORT (y
+ * MQTT_TOPIC). La conexión WiFi no bloquea: ready() reintenta con un
+ * intervalo fijo y mientras tanto las muestras esperan en el buffer.
+ * MQTT sí bloquea algo, porque PubSubClient solo conecta de forma síncrona:
+ * cada intento abre primero el TCP con un plazo de NET_CONNECT_TIMEOUT_MS y,
+ * en la pasada siguiente, espera el CONNACK como mucho MQTT_SOCKET_TIMEOUT_S.
+ * Con el broker caído, loop() (la CLI) se para hasta ese plazo una vez cada
+ * 5 s; la adquisición va en su propia tarea (board.h) y no se detiene.
+ */
+#pragma once
+#include "sample_sink.h"
+
+#define NET_SINK_UDP 1
+#define NET_SINK_MQTT 2
+
+#ifndef NET_SINK
+#define NET_SINK 0
+#endif
+
+#ifndef NET_CONNECT_TIMEOUT_MS
+#define NET_CONNECT_TIMEOUT_MS 300   // apertura TCP hacia el broker
+#endif
+#ifndef MQTT_SOCKET_TIMEOUT_S
+#define MQTT_SOCKET_TIMEOUT_S 1      // espera del CONNACK (mínimo de PubSubClient)
+#endif
+
+// Paquete más grande que se arma (bin: 4 + 15 por muestra)
+#ifndef NET_PACKET_MAX
+#define NET_PACKET_MAX 1024
+#endif
+
+#if NET_SINK
+// Arranca la conexión WiFi (sin esperar a que se complete)
+void netBegin();
+SampleSink& netSink();
+bool netConnected();
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Instrumentación ligera del firmware: tiempos en µs (mín/máx/media) de la
+ * ida y vuelta con el EZO, el parseo, la impresión de muestras y la
+ * iteración de loop(), y contadores de plazos de readPeriodMs perdidos,
+ * timeouts, lecturas no interpretables o perdidas y el mínimo de RAM libre.
+ * Se consulta con "perf" o, periódicamente, con "bench" (tools/bench.py).
+ * Con PERF_ENABLED=0 las llamadas quedan vacías y el compilador las elimina.
+ *
+ * Registro binario ("perf bin"), PERF_FRAME_LEN bytes little-endian:
+ *   [0]       0xA9 sincronía (0xA6 era la versión sin millis, pérdidas ni RAM)
+ *   [1..4]    millis() al emitirlo (uint32; si retrocede, la placa se reinició)
+ *   por cada PerfTimerId: n, mín, máx, media (uint32 cada uno, µs)
+ *   por cada PerfCounterId: contador (uint32)
+ *   mínimo de RAM libre desde el arranque (uint32, bytes; ver board.h)
+ *   [último]  CRC-8 (como en ec_frame.h) de todos los bytes salvo 0 y el CRC
+ */
+#pragma once
+#include <Arduino.h>
+
+#ifndef PERF_ENABLED
+#define PERF_ENABLED 1
+#endif
+
+enum PerfTimerId : uint8_t {
+  PERF_RTT = 0,   // envío del R → respuesta
+  PERF_PARSE,     // ezoParseLine
+  PERF_PRINT,     // emisión de una muestra por Serial
+  PERF_LOOP,      // una iteración de loop()
+  PERF_TIMER_COUNT
+};
+
+enum PerfCounterId : uint8_t {
+  PERF_MISSED_DEADLINE = 0,  // R enviado tarde respecto a readPeriodMs
+  PERF_TIMEOUT,              // transacciones vencidas
+  PERF_PARSE_FAIL,           // líneas de datos no interpretables
+  PERF_DROPPED,              // lecturas perdidas en modo continuo (huecos, desborde RX)
+  PERF_COUNTER_COUNT
+};
+
+static const uint8_t PERF_FRAME_SYNC = 0xA9;
+static const uint8_t PERF_FRAME_LEN = 1 + 4 + PERF_TIMER_COUNT * 16 + PERF_COUNTER_COUNT * 4 + 4 + 1;
+
+#if PERF_ENABLED
+void perfAdd(PerfTimerId id, uint32_t us);
+void perfCount(PerfCounterId id, uint32_t n = 1);
+void perfReset();
+#else
+inline void perfAdd(PerfTimerId, uint32_t) {}
+inline void perfCount(PerfCounterId, uint32_t = 1) {}
+inline void perfReset() {}
+#endif
+
+// Informe en texto; sin PERF_ENABLED solo indica que no está compilada
+void perfPrint(Print& out);
+// Escribe el registro binario en out; devuelve su longitud (0 sin PERF_ENABLED)
+uint8_t perfFrame(uint8_t* out);
+
+// Cronometra el bloque que lo contiene: { PerfScope t(PERF_PARSE); ... }
+class PerfScope {
+ public:
+#if PERF_ENABLED
+  explicit PerfScope(PerfTimerId id) : id_(id), startUs_(micros()) {}
+  ~PerfScope() { perfAdd(id_, micros() - startUs_); }
+
+ private:
+  PerfTimerId id_;
+  unsigned long startUs_;
+#else
+  explicit PerfScope(PerfTimerId) {}
+#endif
+};
@@ -0,0 +1,19 @@
+/*
+ * Reposo del microcontrolador entre ciclos de adquisición (comando "duty").
+ * En AVR usa power-down con el watchdog como despertador, en tramos de
+ * 8 s a 16 ms, y corrige millis()/micros(), que no avanzan con el Timer0
+ * parado. En otras placas cae en delay().
+ */
+#pragma once
+#include <stdint.h>
+
+// Sin power-down real, quien llama puede preferir esperar sin bloquear
+#ifdef __AVR__
+#define POWER_DOWN_AVAILABLE 1
+#else
+#define POWER_DOWN_AVAILABLE 0
+#endif
+
+// Duerme unos ms (precisión del watchdog, ±10 %). Hay que vaciar Serial
+// antes: con el USART apagado lo que quede en el buffer se pierde.
+void powerDown(uint32_t ms);
@@ -0,0 +1,71 @@
+/*
+ * Buffer circular en RAM con las últimas N muestras emitidas.
+ * Permite volcar de una vez (comando "dump") lo adquirido mientras el host
+ * estaba desconectado u ocupado. Cada muestra ocupa 8 bytes, 9 si hay
+ * varias sondas (I2C).
+ * El instante se guarda entero: con stream delta o el ciclo de bajo consumo
+ * dos muestras seguidas pueden distar más de los 65 s de un delta de 16 bits.
+ */
+#pragma once
+#include <stdint.h>
+
+#ifndef SAMPLE_RING_LEN
+#ifdef __AVR__
+#define SAMPLE_RING_LEN 32   // 256 bytes: el Uno solo tiene 2 KB de SRAM
+#else
+#define SAMPLE_RING_LEN 64
+#endif
+#endif
+
+// Por UART hay una sola sonda y no hace falta guardar su índice
+#ifndef SAMPLE_PROBE_FIELD
+#if defined(EZO_TRANSPORT_I2C) && EZO_TRANSPORT_I2C
+#define SAMPLE_PROBE_FIELD 1
+#else
+#define SAMPLE_PROBE_FIELD 0
+#endif
+#endif
+
+struct Sample {
+  uint32_t ms;       // millis() de la muestra
+  int32_t ecMilli;   // EC en milli-µS/cm
+#if SAMPLE_PROBE_FIELD
+  uint8_t probeIdx;
+  uint8_t probe() const { return probeIdx; }   // índice de la sonda
+#else
+  uint8_t probe() const { return 0; }
+#endif
+};
+
+template <uint16_t N>
+class SampleRing {
+ public:
+  // seq es el número de secuencia de la muestra; los guardados son consecutivos
+  void push(uint16_t seq, uint32_t ms, int32_t ecMilli, uint8_t probe) {
+    Sample& s = buf_[(head_ + count_) % N];
+    s.ms = ms;
+    s.ecMilli = ecMilli;
+#if SAMPLE_PROBE_FIELD
+    s.probeIdx = probe;
+#else
+    (void)probe;
+#endif
+    if (count_ < N) count_++;
+    else head_ = (uint16_t)((head_ + 1) % N);  // pisa la más antigua
+    lastSeq_ = seq;
+  }
+
+  uint16_t size() const { return count_; }
+  static uint16_t capacity() { return N; }
+  void clear() { head_ = 0; count_ = 0; }
+
+  // i = 0 es la muestra más antigua
+  const Sample& at(uint16_t i) const { return buf_[(head_ + i) % N]; }
+  uint16_t seqAt(uint16_t i) const { return (uint16_t)(lastSeq_ - (count_ - 1 - i)); }
+
+ private:
+  Sample buf_[N];
+  uint16_t head_ = 0;
+  uint16_t count_ = 0;
+  uint16_t lastSeq_ = 0;
+};
@@ -0,0 +1,105 @@
+/*
+ * Envío de muestras por lotes a un destino de red (net_sink.h). No copia
+ * las muestras: lleva un cursor (secuencia) sobre el buffer circular de
+ * "dump", así lo no enviado espera allí mientras el destino no responde
+ * (contrapresión); si el buffer lo pisa antes de enviarlo se cuenta como
+ * perdido. Un paquete sale al juntar batch muestras o al vencer flushMs con
+ * alguna pendiente.
+ *   bin:  0xA8, n, perdidas (uint16 LE), n registros de ec_frame.h
+ *   json: {"drop":d,"s":[[seq,ms,sonda,ec_milli],...],"n":n}
+ * No depende de Arduino.h (se prueba en native).
+ */
+#pragma once
+#include <stdint.h>
+#include "sample_ring.h"
+
+enum SinkFormat : uint8_t { SINK_BIN = 0, SINK_JSON };
+
+static const uint8_t SINK_PACKET_SYNC = 0xA8;
+static const uint8_t SINK_HEADER_LEN = 4;
+
+// Destino de los paquetes (UDP, MQTT...)
+class SampleSink {
+ public:
+  // Conectado y listo; puede aprovechar para reintentar la conexión
+  virtual bool ready() = 0;
+  virtual bool publish(const uint8_t* buf, uint16_t len) = 0;
+};
+
+class SampleBatcher {
+ public:
+  // batch se acota a 1..255
+  void configure(uint8_t batch, uint32_t flushMs, SinkFormat fmt);
+
+  // Prepara en out (cap bytes) el siguiente paquete si toca. Devuelve las
+  // muestras incluidas, 0 si aún no hay que enviar.
+  template <uint16_t N>
+  uint8_t build(const SampleRing<N>& ring, unsigned long nowMs, uint8_t* out, uint16_t cap, uint16_t& len);
+  // Resultado del envío de lo preparado: sin éxito se reintenta tras flushMs
+  void commit(uint8_t n, bool ok, unsigned long nowMs);
+
+  uint8_t batch() const { return batch_; }
+  uint32_t flushMs() const { return flushMs_; }
+  SinkFormat format() const { return fmt_; }
+  uint32_t sent() const { return sent_; }          // muestras enviadas
+  uint32_t packets() const { return packets_; }
+  uint32_t failures() const { return failures_; }  // envíos rechazados por el destino
+  uint32_t dropped() const { return dropped_; }    // pisadas en el buffer sin enviar
+
+ private:
+  void begin(uint8_t* out, uint16_t cap);
+  bool add(const Sample& s, uint16_t seq);
+  uint16_t end();
+
+  uint8_t batch_ = 16;
+  uint32_t flushMs_ = 5000;
+  SinkFormat fmt_ = SINK_BIN;
+  bool started_ = false;
+  uint16_t next_ = 0;          // secuencia de la siguiente muestra a enviar
+  unsigned long lastFlushMs_ = 0;
+  bool retrying_ = false;      // el último envío falló: nada hasta retryAtMs_
+  unsigned long retryAtMs_ = 0;
+  uint16_t dropPending_ = 0;   // perdidas a notificar en el próximo paquete
+  uint32_t sent_ = 0;
+  uint32_t packets_ = 0;
+  uint32_t failures_ = 0;
+  uint32_t dropped_ = 0;
+
+  uint8_t* out_ = nullptr;     // paquete en construcción
+  uint16_t cap_ = 0;
+  uint16_t len_ = 0;
+  uint8_t n_ = 0;
+};
+
+template <uint16_t N>
+uint8_t SampleBatcher::build(const SampleRing<N>& ring, unsigned long nowMs, uint8_t* out, uint16_t cap,
+                             uint16_t& len) {
+  const uint16_t size = ring.size();
+  if (size == 0) return 0;
+  const uint16_t oldest = ring.seqAt(0);
+  if (!started_) {
+    next_ = oldest;
+    started_ = true;
+    lastFlushMs_ = nowMs;
+  }
+  const int16_t behind = (int16_t)(oldest - next_);
+  if (behind > 0) {   // el buffer dio la vuelta sobre muestras sin enviar
+    dropped_ += (uint16_t)behind;
+    dropPending_ = (uint16_t)(dropPending_ + behind);
+    next_ = oldest;
+  }
+  const uint16_t skip = (uint16_t)(next_ - oldest);
+  if (skip >= size) return 0;
+  // tras un fallo se espera flushMs aunque el lote esté lleno, para no
+  // reintentar en cada pasada contra un destino caído
+  if (retrying_ && (long)(nowMs - retryAtMs_) < 0) return 0;
+  const uint16_t pending = size - skip;
+  if (!retrying_ && pending < batch_ && nowMs - lastFlushMs_ < flushMs_) return 0;
+
+  begin(out, cap);
+  for (uint16_t i = skip; i < size && n_ < batch_; i++) {
+    if (!add(ring.at(i), ring.seqAt(i))) break;
+  }
+  len = end();
+  return n_;
+}
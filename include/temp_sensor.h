@@ -0,0 +1,52 @@
+/*
+ * Sensor de temperatura local para la compensación automática del EZO:
+ * un DS18B20 por 1-Wire en TEMP_DS18B20_PIN (compilar con
+ * -DTEMP_DS18B20_PIN=<pin>). La conversión (~750 ms a 12 bits) se lanza y
+ * se recoge desde poll(), sin esperar en el loop.
+ */
+#pragma once
+#include <Arduino.h>
+
+#ifdef TEMP_DS18B20_PIN
+#define TEMP_SENSOR 1
+#else
+#define TEMP_SENSOR 0
+#endif
+
+#ifndef TEMP_PERIOD_MS
+#define TEMP_PERIOD_MS 2000      // una conversión cada 2 s
+#endif
+
+// Temperaturas en centésimas de °C; TEMP_NONE = sin lectura válida
+static const int16_t TEMP_NONE = INT16_MIN;
+
+#if TEMP_SENSOR
+#include <OneWire.h>
+
+// Un único DS18B20 en el bus (SKIP ROM), alimentado por VDD (no parásito)
+class Ds18b20 {
+ public:
+  static const uint16_t CONVERSION_MS = 750;   // 12 bits
+
+  explicit Ds18b20(uint8_t pin) : bus_(pin) {}
+
+  // Avanza la conversión; devuelve true si hay una temperatura nueva.
+  // quiet indica que se puede usar el bus: los slots de 1-Wire desactivan
+  // las interrupciones unos 70 µs y podrían corromper un byte de
+  // SoftwareSerial que esté llegando del EZO.
+  bool poll(unsigned long nowMs, bool quiet);
+
+  int16_t centi() const { return centi_; }
+  uint16_t errors() const { return errors_; }   // sin sensor o CRC erróneo
+
+ private:
+  bool startConversion();
+  bool readScratchpad(int16_t& centi);
+
+  OneWire bus_;
+  bool converting_ = false;
+  unsigned long startMs_ = 0;
+  int16_t centi_ = TEMP_NONE;
+  uint16_t errors_ = 0;
+};
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Tipo numérico de las lecturas: punto fijo (milésimas) o float.
+ * El Uno no tiene FPU; con EC_FIXED_POINT=1 (por defecto) todo el camino
+ * de una lectura usa enteros: EC en milli-µS/cm, TDS en milli-ppm, SG en
+ * milésimas. Compila con -DEC_FIXED_POINT=0 para volver a float.
+ */
+#pragma once
+#include <stdint.h>
+
+#ifndef EC_FIXED_POINT
+#define EC_FIXED_POINT 1
+#endif
+
+#if EC_FIXED_POINT
+typedef int32_t ec_value_t;            // valor × 1000
+static const uint8_t EC_FRAC_DIGITS = 3;
+#else
+typedef float ec_value_t;
+#endif
+
+// v * num / den sin desbordar int32 (r * num debe caber: den * num < 2^31)
+inline ec_value_t ecMulFrac(ec_value_t v, uint16_t num, uint32_t den) {
+#if EC_FIXED_POINT
+  const int32_t q = v / (int32_t)den;
+  const int32_t r = v % (int32_t)den;
+  return q * (int32_t)num + (r * (int32_t)num) / (int32_t)den;
+#else
+  return v * ((float)num / (float)den);
+#endif
+}
+
+inline ec_value_t ecFromInt(int32_t v) {
+#if EC_FIXED_POINT
+  return v * 1000;
+#else
+  return (float)v;
+#endif
+}
+
+inline ec_value_t ecFromMilli(int32_t milli) {
+#if EC_FIXED_POINT
+  return milli;
+#else
+  return (float)milli / 1000.0f;
+#endif
+}
+
+// Valor en milésimas (formato de intercambio: registros binarios, buffers)
+inline int32_t ecToMilli(ec_value_t v) {
+#if EC_FIXED_POINT
+  return v;
+#else
+  return (int32_t)(v * 1000.0f + (v < 0 ? -0.5f : 0.5f));
+#endif
+}
+
+inline float ecToFloat(ec_value_t v) {
+#if EC_FIXED_POINT
+  return (float)v / 1000.0f;
+#else
+  return v;
+#endif
+}
+
+// Formatea v (milésimas) con 0..3 decimales, redondeando, solo con enteros.
+// out necesita al menos 13 bytes. Devuelve la longitud escrita.
+inline uint8_t formatMilli(char* out, int32_t v, uint8_t decimals) {
+  static const int32_t STEP[] = { 1000, 100, 10, 1 };
+  if (decimals > 3) decimals = 3;
+  uint32_t u = (v < 0) ? (uint32_t)(-(v + 1)) + 1u : (uint32_t)v;
+  const uint32_t step = (uint32_t)STEP[decimals];
+  u = (u + step / 2) / step * step;  // redondeo al último decimal mostrado
+  char tmp[12];
+  uint8_t n = 0;
+  uint32_t ip = u / 1000u;
+  uint32_t fp = (u % 1000u) / step;
+  for (uint8_t i = 0; i < decimals; i++) { tmp[n++] = (char)('0' + fp % 10u); fp /= 10u; }
+  if (decimals) tmp[n++] = '.';
+  do { tmp[n++] = (char)('0' + ip % 10u); ip /= 10u; } while (ip);
+  uint8_t len = 0;
+  if (v < 0 && u != 0) out[len++] = '-';
+  while (n) out[len++] = tmp[--n];
+  out[len] = '\0';
+  return len;
+}
@@ -0,0 +1,56 @@
+#include "ezo_cache.h"
+#include <Arduino.h>
+
+namespace {
+
+const unsigned long STATUS_MAX_AGE_MS = 60000;   // el voltaje puede cambiar
+
+// Consulta exacta de cada entrada y prefijo de los ajustes que la invalidan
+const char* const QUERIES[EZO_CACHE_SLOTS] = { "K,?", "O,?", "Cal,?", "I", "Status" };
+const char* const SETTERS[EZO_CACHE_SLOTS] = { "K,", "O,", "Cal,", nullptr, nullptr };
+
+}  // namespace
+
+EzoCacheSlot EzoQueryCache::slotOf(const char* cmd) {
+  for (uint8_t i = 0; i < EZO_CACHE_SLOTS; i++) {
+    if (strcasecmp(cmd, QUERIES[i]) == 0) return (EzoCacheSlot)i;
+  }
+  return EZO_CACHE_NONE;
+}
+
+const char* EzoQueryCache::lookup(const char* cmd, unsigned long nowMs, unsigned long* ageMs) const {
+  const EzoCacheSlot slot = slotOf(cmd);
+  if (slot == EZO_CACHE_NONE) return nullptr;
+  const Entry& e = entries_[slot];
+  if (e.resp[0] == '\0') return nullptr;
+  const unsigned long age = nowMs - e.ms;
+  if (slot == EZO_CACHE_STATUS && age > STATUS_MAX_AGE_MS) return nullptr;
+  if (ageMs) *ageMs = age;
+  return e.resp;
+}
+
+void EzoQueryCache::note(const char* cmd, EzoStatus status, const char* resp, uint8_t len, unsigned long nowMs) {
+  const EzoCacheSlot slot = slotOf(cmd);
+  if (slot != EZO_CACHE_NONE) {
+    // solo respuestas completas de datos ("?K,1.0"), nunca "*ER" ni parciales
+    if (status == EZO_OK && len > 0 && len <= EZO_CACHE_RESP_MAX && resp[0] == '?') {
+      memcpy(entries_[slot].resp, resp, len);
+      entries_[slot].resp[len] = '\0';
+      entries_[slot].ms = nowMs;
+    }
+    return;
+  }
+  // Un ajuste rechazado no cambió nada; uno sin respuesta puede haberse aplicado
+  if (status == EZO_OK && len > 0 && strncmp(resp, "*ER", 3) == 0) return;
+  if (strcasecmp(cmd, "Factory") == 0) {
+    clear();
+    return;
+  }
+  for (uint8_t i = 0; i < EZO_CACHE_SLOTS; i++) {
+    if (SETTERS[i] && strncasecmp(cmd, SETTERS[i], strlen(SETTERS[i])) == 0) entries_[i].resp[0] = '\0';
+  }
+}
+
+void EzoQueryCache::clear() {
+  for (Entry& e : entries_) e.resp[0] = '\0';
+}
@@ -0,0 +1,47 @@
+/*
+ * Caché de las consultas idempotentes del EZO (K,?  O,?  Cal,?  I  Status)
+ * para contestar a la CLI sin ida y vuelta al sensor. Se alimenta con cada
+ * transacción completada (EzoLink::setObserver): guarda la respuesta de la
+ * consulta y borra la entrada cuando un ajuste que la cambia (K,  O,  Cal,
+ * Factory) termina sin "*ER". Status lleva voltaje, así que caduca.
+ */
+#pragma once
+#include <stdint.h>
+#include "ezo_link.h"
+
+#ifndef EZO_CACHE_RESP_MAX
+#define EZO_CACHE_RESP_MAX 18   // "?O,EC,TDS,S,SG", "?Status,P,5.038"
+#endif
+
+enum EzoCacheSlot : uint8_t {
+  EZO_CACHE_K = 0,
+  EZO_CACHE_O,
+  EZO_CACHE_CAL,
+  EZO_CACHE_INFO,
+  EZO_CACHE_STATUS,
+  EZO_CACHE_SLOTS,
+  EZO_CACHE_NONE = 0xFF,
+};
+
+class EzoQueryCache {
+ public:
+  // Entrada que contesta cmd, o EZO_CACHE_NONE si no es una consulta cacheable
+  static EzoCacheSlot slotOf(const char* cmd);
+
+  // Respuesta guardada para cmd (nullptr si no hay o caducó); ageMs es su edad
+  const char* lookup(const char* cmd, unsigned long nowMs, unsigned long* ageMs = nullptr) const;
+  // Transacción terminada con el EZO
+  void note(const char* cmd, EzoStatus status, const char* resp, uint8_t len, unsigned long nowMs);
+  void clear();
+
+  uint32_t hits() const { return hits_; }
+  void countHit() { hits_++; }
+
+ private:
+  struct Entry {
+    char resp[EZO_CACHE_RESP_MAX + 1];   // vacía = sin dato
+    unsigned long ms;
+  };
+  Entry entries_[EZO_CACHE_SLOTS] = {};
+  uint32_t hits_ = 0;
+};
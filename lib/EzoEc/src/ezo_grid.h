@@ -0,0 +1,35 @@
+/*
+ * Rejilla fija de envíos periódicos (lecturas R del streaming). Cada envío
+ * avanza el siguiente hueco un periodo exacto, así ni el RTT ni la latencia
+ * del loop se acumulan como deriva. Un retraso menor que un periodo se
+ * recupera en el hueco siguiente; si se va más de un periodo tarde se saltan
+ * los huecos perdidos sin perder la fase.
+ */
+#pragma once
+#include <stdint.h>
+
+class EzoReadGrid {
+ public:
+  // El primer hueco es nowMs
+  void start(unsigned long nowMs) { nextMs_ = nowMs; }
+  bool due(unsigned long nowMs) const { return (long)(nowMs - nextMs_) >= 0; }
+  // Retraso del envío actual respecto a su hueco (con due() cierto)
+  unsigned long lateMs(unsigned long nowMs) const { return nowMs - nextMs_; }
+
+  // Se envió el hueco actual: pasa al siguiente. Devuelve los huecos saltados.
+  uint32_t advance(unsigned long nowMs, unsigned long periodMs) {
+    nextMs_ += periodMs;
+    if (!due(nowMs)) return 0;
+    const uint32_t missed = (uint32_t)((nowMs - nextMs_) / periodMs + 1);
+    nextMs_ += missed * periodMs;
+    skipped_ += missed;
+    return missed;
+  }
+
+  unsigned long nextMs() const { return nextMs_; }
+  uint32_t skipped() const { return skipped_; }
+
+ private:
+  unsigned long nextMs_ = 0;
+  uint32_t skipped_ = 0;
+};
@@ -0,0 +1,69 @@
+#include "ezo_health.h"
+#include <Arduino.h>
+
+void EzoHealth::noteLine(const char* line, uint8_t len) {
+  if (len < 3 || line[0] != '*') return;
+  if (strncmp(line, "*ER", 3) == 0) {
+    errors_++;
+  } else if (strncmp(line, "*OV", 3) == 0) {
+    overVolt_++;
+    if (state_ == EZO_HEALTH_OK) state_ = EZO_HEALTH_DEGRADED;
+  } else if (strncmp(line, "*UV", 3) == 0) {
+    underVolt_++;
+    if (state_ == EZO_HEALTH_OK) state_ = EZO_HEALTH_DEGRADED;
+  } else if (strncmp(line, "*RS", 3) == 0) {
+    resets_++;
+    rebooting_ = true;     // se reconfigura cuando vuelva a estar listo
+  } else if (strncmp(line, "*RE", 3) == 0) {
+    if (!rebooting_) resets_++;   // arranque sin *RS previo (corte de alimentación)
+    rebooting_ = false;
+    reconfigure_ = true;
+  }
+}
+
+void EzoHealth::noteReply(EzoStatus status, uint8_t len) {
+  if (status == EZO_TIMEOUT && len == 0) {
+    timeouts_++;
+    if (consecutive_ < 255) consecutive_++;
+    if (state_ != EZO_HEALTH_DOWN && consecutive_ >= EZO_DOWN_AFTER) {
+      state_ = EZO_HEALTH_DOWN;
+      downs_++;
+      backoffMs_ = BACKOFF_MIN_MS;
+      retryArmed_ = false;
+    } else if (state_ == EZO_HEALTH_OK) {
+      state_ = EZO_HEALTH_DEGRADED;
+    }
+    return;
+  }
+  // cualquier línea, aunque sea *ER o parcial, prueba que la sonda contesta
+  // pudo reiniciarse sin oírse el *RE
+  if (state_ == EZO_HEALTH_DOWN || rebooting_) {
+    reconfigure_ = true;
+    rebooting_ = false;
+  }
+  consecutive_ = 0;
+  if (state_ != EZO_HEALTH_OK && status == EZO_OK) state_ = EZO_HEALTH_OK;
+}
+
+bool EzoHealth::allow(unsigned long nowMs) {
+  if (state_ != EZO_HEALTH_DOWN) return true;
+  if (!retryArmed_) {
+    retryArmed_ = true;
+    retryMs_ = nowMs + backoffMs_;
+    return false;
+  }
+  if ((long)(nowMs - retryMs_) < 0) return false;
+  backoffMs_ = (backoffMs_ >= BACKOFF_MAX_MS / 2) ? BACKOFF_MAX_MS : (uint16_t)(backoffMs_ * 2);
+  retryMs_ = nowMs + backoffMs_;
+  return true;
+}
+
+bool EzoHealth::takeReconfigure() {
+  if (!reconfigure_) return false;
+  reconfigure_ = false;
+  return true;
+}
+
+void EzoHealth::clearCounters() {
+  timeouts_ = errors_ = overVolt_ = underVolt_ = resets_ = downs_ = 0;
+}
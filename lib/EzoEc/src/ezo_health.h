@@ -0,0 +1,64 @@
+/*
+ * Estado de salud de un EZO a partir de sus respuestas. Cuenta los códigos
+ * de error (*ER, *OV, *UV), los reinicios (*RS, *RE) y los timeouts; tras
+ * varios timeouts seguidos da la sonda por caída y solo deja pasar un
+ * sondeo cada cierto tiempo, con espera exponencial, en lugar de gastar el
+ * loop en plazos vencidos. Tras un reinicio o una reconexión pide una única
+ * reconfiguración (takeReconfigure).
+ */
+#pragma once
+#include <stdint.h>
+#include "ezo_link.h"
+
+#ifndef EZO_DOWN_AFTER
+#define EZO_DOWN_AFTER 3   // timeouts seguidos para darla por caída
+#endif
+
+enum EzoHealthState : uint8_t {
+  EZO_HEALTH_OK = 0,
+  EZO_HEALTH_DEGRADED,   // algún timeout u *OV/*UV reciente
+  EZO_HEALTH_DOWN,       // sin respuesta: solo sondeos con espera exponencial
+};
+
+class EzoHealth {
+ public:
+  static const uint16_t BACKOFF_MIN_MS = 1000;
+  static const uint16_t BACKOFF_MAX_MS = 60000;
+
+  // Cada línea "*.." recibida, dentro o fuera de una transacción
+  void noteLine(const char* line, uint8_t len);
+  // Cada transacción terminada
+  void noteReply(EzoStatus status, uint8_t len);
+
+  // ¿Se puede enviar el siguiente comando periódico? Con la sonda caída
+  // devuelve true una vez por espera (ese envío hace de sondeo) y duplica
+  // la espera siguiente.
+  bool allow(unsigned long nowMs);
+  // true una sola vez tras *RS/*RE o al recuperarse de una caída
+  bool takeReconfigure();
+
+  EzoHealthState state() const { return state_; }
+  uint16_t backoffMs() const { return backoffMs_; }
+  uint32_t timeouts() const { return timeouts_; }
+  uint32_t errors() const { return errors_; }        // *ER
+  uint32_t overVolt() const { return overVolt_; }    // *OV
+  uint32_t underVolt() const { return underVolt_; }  // *UV
+  uint32_t resets() const { return resets_; }        // *RS / *RE
+  uint32_t downs() const { return downs_; }          // veces que se dio por caída
+  void clearCounters();
+
+ private:
+  EzoHealthState state_ = EZO_HEALTH_OK;
+  uint8_t consecutive_ = 0;   // timeouts seguidos
+  bool reconfigure_ = false;
+  bool rebooting_ = false;    // llegó *RS y aún no *RE
+  uint16_t backoffMs_ = BACKOFF_MIN_MS;
+  unsigned long retryMs_ = 0;
+  bool retryArmed_ = false;
+  uint32_t timeouts_ = 0;
+  uint32_t errors_ = 0;
+  uint32_t overVolt_ = 0;
+  uint32_t underVolt_ = 0;
+  uint32_t resets_ = 0;
+  uint32_t downs_ = 0;
+};
@@ -0,0 +1,64 @@
+/*
+ * Lector de líneas del EZO sobre un buffer estático de tamaño fijo.
+ * No usa el heap: la línea se expone como vista (const char*, longitud) y la
+ * pérdida de bytes por desbordamiento se informa explícitamente.
+ */
+#pragma once
+#include <stdint.h>
+
+// La respuesta más larga ("EC,..,TDS,..,SAL,..,SG,..") cabe en 40 bytes
+static const uint8_t EZO_LINE_MAX = 40;
+
+enum EzoLineEvent : uint8_t {
+  EZO_LINE_NONE = 0,    // aún no hay línea completa
+  EZO_LINE_READY,       // línea completa terminada en '\r'
+  EZO_LINE_TRUNCATED,   // línea completa, pero se descartaron bytes al final
+};
+
+class EzoLineReader {
+ public:
+  EzoLineReader() { reset(); }
+
+  // Procesa un byte; la línea devuelta sigue válida hasta el siguiente feed()
+  EzoLineEvent feed(char c) {
+    if (done_) reset();
+    if (c == '\r') {
+      done_ = true;
+      if (overflow_) {
+        truncations_++;
+        return EZO_LINE_TRUNCATED;
+      }
+      return EZO_LINE_READY;
+    }
+    if (c < 32 || c > 126) return EZO_LINE_NONE;  // filtra no imprimibles
+    if (len_ >= EZO_LINE_MAX) {
+      overflow_ = true;
+      return EZO_LINE_NONE;
+    }
+    buf_[len_++] = c;
+    buf_[len_] = '\0';
+    return EZO_LINE_NONE;
+  }
+
+  void reset() {
+    len_ = 0;
+    buf_[0] = '\0';
+    overflow_ = false;
+    done_ = false;
+  }
+
+  // Marca la línea en curso como recortada (p. ej. el transporte no pudo leerla entera)
+  void markOverflow() { overflow_ = true; }
+
+  const char* line() const { return buf_; }
+  uint8_t length() const { return len_; }
+  bool overflowed() const { return overflow_; }   // la línea en curso perdió bytes
+  uint16_t truncations() const { return truncations_; }
+
+ private:
+  char buf_[EZO_LINE_MAX + 1];
+  uint8_t len_;
+  bool overflow_;
+  bool done_;
+  uint16_t truncations_ = 0;
+};
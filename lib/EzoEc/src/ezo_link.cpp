@@ -0,0 +1,107 @@
+#include "ezo_link.h"
+
+bool EzoLink::submit(const char* cmd, uint16_t timeoutMs, EzoDoneFn done, void* ctx) {
+  if (count_ >= QUEUE_LEN) return false;
+  if (strlen(cmd) >= CMD_MAX) return false;
+  Request& r = queue_[(head_ + count_) % QUEUE_LEN];
+  strcpy(r.cmd, cmd);
+  r.cls = ezoClassify(cmd);
+  r.timeoutMs = (timeoutMs == EZO_TIMEOUT_AUTO) ? ezoWorstCaseMs(r.cls) : timeoutMs;
+  r.done = done;
+  r.ctx = ctx;
+  count_++;
+  return true;
+}
+
+void EzoLink::flushInput() {
+  if (active_) return;
+  port_->flush();
+}
+
+void EzoLink::sendHead() {
+  const Request& r = queue_[head_];
+  const EzoResponseShape shape = ezoResponseShape(r.cls, port_->sendsCodes());
+  dataLeft_ = shape.dataLines;
+  codesLeft_ = shape.codeLines;
+  delivered_ = false;
+  timeoutMs_ = lat_[r.cls].timeoutMs(r.timeoutMs);
+  rx_.reset();
+  port_->send(r.cmd);
+  sentMs_ = millis();
+  sentUs_ = micros();
+  active_ = true;
+}
+
+void EzoLink::deliver(EzoStatus status) {
+  delivered_ = true;
+  const Request& r = queue_[head_];
+  if (observer_) observer_(*this, status, r.cmd, rx_.line(), rx_.length(), observerCtx_);
+  if (r.done) r.done(*this, status, r.cmd, rx_.line(), rx_.length(), r.ctx);
+}
+
+void EzoLink::finish(bool complete) {
+  EzoLatency& lat = lat_[queue_[head_].cls];
+  if (complete) lat.add((uint16_t)(millis() - sentMs_));
+  else lat.reset();
+  head_ = (head_ + 1) % QUEUE_LEN;
+  count_--;
+  active_ = false;
+}
+
+// Tras un timeout la respuesta del comando vencido puede llegar aún: su
+// línea de datos o su *OK se tomarían como la respuesta del siguiente. Por
+// UART se descartan líneas hasta recibir los códigos que faltaban o hasta
+// el techo del plazo de la clase, con al menos EZO_DRAIN_QUIET_MS de espera.
+// Por I2C la respuesta solo se lee a petición y el siguiente envío la anula.
+void EzoLink::startDrain() {
+  draining_ = port_->sendsCodes() && codesLeft_ > 0;
+  if (!draining_) return;
+  const unsigned long now = millis();
+  drainUntilMs_ = sentMs_ + queue_[head_].timeoutMs;
+  if ((long)(drainUntilMs_ - now) < (long)EZO_DRAIN_QUIET_MS) drainUntilMs_ = now + EZO_DRAIN_QUIET_MS;
+}
+
+void EzoLink::poll() {
+  if (draining_ && (long)(millis() - drainUntilMs_) >= 0) draining_ = false;
+  if (!active_ && !draining_ && count_ > 0) sendHead();
+  if (!active_ && !draining_ && monitor_ == nullptr) return;
+
+  EzoLineEvent ev;
+  while ((ev = port_->poll(rx_)) != EZO_LINE_NONE) {
+    if (monitor_ && monitor_(*this, rx_.line(), rx_.length(), ev, monitorCtx_)) continue;
+    const char* line = rx_.line();
+    if (draining_) {
+      if (line[0] != '*') continue;  // datos tardíos del comando vencido
+      if (codesLeft_ > 0) codesLeft_--;
+      if (strncmp(line, "*ER", 3) == 0 || strncmp(line, "*RE", 3) == 0) codesLeft_ = 0;
+      if (codesLeft_ == 0) {
+        draining_ = false;
+        return;  // el siguiente comando se envía en el próximo poll()
+      }
+      continue;
+    }
+    if (!active_) continue;  // no solicitada ni consumida por el observador: se descarta
+
+    if (line[0] == '*') {
+      // Un código cierra la fase de datos; *ER y *RE (listo) terminan ya
+      dataLeft_ = 0;
+      if (codesLeft_ > 0) codesLeft_--;
+      if (strncmp(line, "*ER", 3) == 0 || strncmp(line, "*RE", 3) == 0) codesLeft_ = 0;
+    } else if (dataLeft_ > 0) {
+      dataLeft_--;
+    } else {
+      continue;  // datos sobrantes (p. ej. el EZO ya emitía en modo continuo)
+    }
+    if (!delivered_) deliver(ev == EZO_LINE_TRUNCATED ? EZO_TRUNCATED : EZO_OK);
+    if (dataLeft_ == 0 && codesLeft_ == 0) {
+      finish(true);
+      return;
+    }
+  }
+
+  if (active_ && millis() - sentMs_ >= timeoutMs_) {
+    if (!delivered_) deliver(EZO_TIMEOUT);
+    startDrain();
+    finish(false);
+  }
+}
@@ -0,0 +1,127 @@
+/*
+ * Motor asíncrono de peticiones/respuestas para el EZO EC.
+ * Mantiene una cola pequeña de comandos pendientes; cada uno tiene su propio
+ * plazo y se avanza llamando a poll() desde loop(), sin esperas activas.
+ * Cada transacción consume todas las líneas que el modelo de respuesta
+ * (ezo_response.h) espera del comando, y el plazo se adapta a la latencia
+ * medida para cada clase de comando.
+ */
+#pragma once
+#include <Arduino.h>
+#include "ezo_line.h"
+#include "ezo_transport.h"
+#include "ezo_response.h"
+
+// Resultado de una transacción con el EZO
+enum EzoStatus : uint8_t {
+  EZO_OK = 0,     // llegó la respuesta (datos, o el código si no lleva datos)
+  EZO_TIMEOUT,    // venció el plazo (resp puede traer una línea parcial)
+  EZO_TRUNCATED,  // la línea superó EZO_LINE_MAX y se recortó
+};
+
+class EzoLink;
+
+// Se invoca al llegar la respuesta; cmd es el comando enviado y resp/len
+// una vista de la respuesta, válida solo durante el callback. En comandos
+// con datos resp es la línea de datos: el "*OK" posterior lo consume EzoLink.
+typedef void (*EzoDoneFn)(EzoLink& link, EzoStatus status, const char* cmd,
+                          const char* resp, uint8_t len, void* ctx);
+
+// Observa cada línea recibida antes de entregarla; si devuelve true la línea
+// se considera consumida (p. ej. una lectura del modo continuo) y no se
+// usa como respuesta del comando activo
+typedef bool (*EzoLineFn)(EzoLink& link, const char* line, uint8_t len, EzoLineEvent ev, void* ctx);
+
+#ifndef EZO_QUEUE_LEN
+#define EZO_QUEUE_LEN 6
+#endif
+
+// Espera mínima tras un timeout antes de enviar el siguiente comando, por
+// si la respuesta del vencido llega tarde (ver EzoLink::startDrain)
+#ifndef EZO_DRAIN_QUIET_MS
+#define EZO_DRAIN_QUIET_MS 50
+#endif
+
+// Pasado como timeoutMs: plazo adaptativo con el peor caso de la clase como techo
+static const uint16_t EZO_TIMEOUT_AUTO = 0;
+
+class EzoLink {
+ public:
+  static const uint8_t QUEUE_LEN = EZO_QUEUE_LEN;  // comandos en espera (incluye el activo)
+  static const uint8_t CMD_MAX = 24;    // "Cal,high,12880.00" cabe sobrado
+
+  EzoLink() {}
+  explicit EzoLink(EzoTransport& port, uint8_t id = 0) { begin(port, id); }
+
+  // Asocia el transporte; id identifica la sonda (varios EZO en una placa)
+  void begin(EzoTransport& port, uint8_t id) { port_ = &port; id_ = id; }
+  uint8_t id() const { return id_; }
+
+  // Encola un comando; devuelve false si la cola está llena o no cabe.
+  // timeoutMs es el techo del plazo (EZO_TIMEOUT_AUTO = peor caso de la clase);
+  // el plazo efectivo baja a media + 4·desviación de la latencia medida.
+  bool submit(const char* cmd, uint16_t timeoutMs, EzoDoneFn done = nullptr, void* ctx = nullptr);
+
+  // Avanza la máquina de estados: envía, recibe y vence plazos
+  void poll();
+
+  // Instala el observador de líneas. Sin observador, lo que llega sin
+  // transacción activa se deja en el transporte.
+  void setMonitor(EzoLineFn fn, void* ctx = nullptr) { monitor_ = fn; monitorCtx_ = ctx; }
+  // Instala un observador que ve cada respuesta antes que el callback del
+  // comando (p. ej. para la caché de consultas, ezo_cache.h)
+  void setObserver(EzoDoneFn fn, void* ctx = nullptr) { observer_ = fn; observerCtx_ = ctx; }
+
+  // Momento (millis) en que se envió el último comando; dentro de un
+  // callback corresponde al comando que acaba de completarse
+  unsigned long lastSentMs() const { return sentMs_; }
+  unsigned long lastSentUs() const { return sentUs_; }   // ídem en micros()
+
+  // También ocupado mientras descarta la respuesta tardía de un timeout
+  bool busy() const { return count_ > 0 || draining_; }
+  uint8_t pending() const { return count_; }
+
+  // Descarta bytes sin leer del EZO (solo si no hay transacción activa)
+  void flushInput();
+
+  // Respuestas recortadas por exceder EZO_LINE_MAX desde el arranque
+  uint16_t truncations() const { return rx_.truncations(); }
+
+  // Latencia medida (envío → última línea) de una clase de comando
+  const EzoLatency& latency(EzoCmdClass cls) const { return lat_[cls]; }
+
+ private:
+  struct Request {
+    char cmd[CMD_MAX];
+    uint16_t timeoutMs;        // techo del plazo
+    EzoCmdClass cls;
+    EzoDoneFn done;
+    void* ctx;
+  };
+
+  void sendHead();
+  void deliver(EzoStatus status);
+  void finish(bool complete);
+  void startDrain();
+
+  EzoTransport* port_ = nullptr;
+  uint8_t id_ = 0;
+  Request queue_[QUEUE_LEN];
+  uint8_t head_ = 0;
+  uint8_t count_ = 0;
+  bool active_ = false;        // el comando de la cabeza ya fue enviado
+  bool delivered_ = false;     // su callback ya se llamó; faltan códigos
+  bool draining_ = false;      // descartando la respuesta tardía de un timeout
+  uint8_t dataLeft_ = 0;       // líneas de datos que aún se esperan
+  uint8_t codesLeft_ = 0;      // códigos "*XX" que aún se esperan
+  uint16_t timeoutMs_ = 0;     // plazo efectivo del comando activo
+  unsigned long sentMs_ = 0;
+  unsigned long sentUs_ = 0;
+  unsigned long drainUntilMs_ = 0;
+  EzoLatency lat_[EZO_CMD_CLASS_COUNT];
+  EzoLineReader rx_;
+  EzoLineFn monitor_ = nullptr;
+  void* monitorCtx_ = nullptr;
+  EzoDoneFn observer_ = nullptr;
+  void* observerCtx_ = nullptr;
+};
@@ -0,0 +1,142 @@
+#include "ezo_parse.h"
+
+namespace {
+
+#if !EC_FIXED_POINT
+const float POW10[] = { 1.0f, 10.0f, 100.0f, 1000.0f, 10000.0f, 100000.0f,
+                        1000000.0f, 10000000.0f, 100000000.0f, 1000000000.0f };
+#endif
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+
+// Devuelve el índice de campo si [p, e) es una etiqueta, o -1
+int8_t labelIndex(const char* p, const char* e) {
+  uint8_t n = (uint8_t)(e - p);
+  if (n == 2 && p[0] == 'E' && p[1] == 'C') return 0;
+  if (n == 3 && p[0] == 'T' && p[1] == 'D' && p[2] == 'S') return 1;
+  if (n == 3 && p[0] == 'S' && p[1] == 'A' && p[2] == 'L') return 2;
+  if (n == 2 && p[0] == 'S' && p[1] == 'G') return 3;
+  return -1;
+}
+
+// Número decimal estricto: [+-]dígitos[.dígitos]. Devuelve false si hay basura.
+#if EC_FIXED_POINT
+// En punto fijo conserva 3 decimales (los siguientes se truncan).
+bool parseNumber(const char* p, const char* e, ec_value_t& out) {
+  bool neg = false;
+  if (p < e && (*p == '-' || *p == '+')) { neg = (*p == '-'); p++; }
+  int32_t ip = 0;
+  int32_t fp = 0;
+  uint8_t frac = 0;
+  bool dot = false, any = false;
+  for (; p < e; p++) {
+    char c = *p;
+    if (c == '.' && !dot) { dot = true; continue; }
+    if (c < '0' || c > '9') return false;
+    any = true;
+    if (!dot) {
+      ip = ip * 10 + (c - '0');
+      if (ip > 2147482) return false;  // ip * 1000 + 999 no cabría en int32
+    } else if (frac < EC_FRAC_DIGITS) {
+      fp = fp * 10 + (c - '0');
+      frac++;
+    }
+  }
+  if (!any) return false;
+  for (; frac < EC_FRAC_DIGITS; frac++) fp *= 10;
+  const int32_t v = ip * 1000 + fp;
+  out = neg ? -v : v;
+  return true;
+}
+#else
+bool parseNumber(const char* p, const char* e, ec_value_t& out) {
+  bool neg = false;
+  if (p < e && (*p == '-' || *p == '+')) { neg = (*p == '-'); p++; }
+  uint32_t mant = 0;
+  uint8_t sig = 0, frac = 0;
+  bool dot = false, any = false;
+  for (; p < e; p++) {
+    char c = *p;
+    if (c == '.' && !dot) { dot = true; continue; }
+    if (c < '0' || c > '9') return false;
+    any = true;
+    // Más allá de 9 cifras significativas la precisión de float ya no aporta
+    if (sig < 9 && frac < 9) {
+      mant = mant * 10 + (uint32_t)(c - '0');
+      if (mant != 0) sig++;
+      if (dot) frac++;
+    } else if (!dot) {
+      return false;  // parte entera fuera de rango
+    }
+  }
+  if (!any) return false;
+  float f = (float)mant / POW10[frac];
+  out = neg ? -f : f;
+  return true;
+}
+#endif
+
+}  // namespace
+
+uint8_t ezoParseLine(const char* s, uint8_t len, EcReading& out) {
+  const char* p = s;
+  const char* end = s + len;
+  while (p < end && isSpace(*p)) p++;
+  while (end > p && isSpace(end[-1])) end--;
+  if (p == end) return 0;
+  if (*p == '*' || *p == '?') return 0;  // *OK, *ER, ?K,... no son lecturas
+
+  ec_value_t vals[4] = { 0, 0, 0, 0 };
+  uint8_t mask = 0;        // campos con etiqueta
+  uint8_t positional = 0;  // valores sin etiqueta
+  int8_t pending = -1;     // etiqueta a la espera de su valor
+  bool labeled = false;
+
+  while (p <= end) {
+    const char* tokEnd = p;
+    while (tokEnd < end && *tokEnd != ',') tokEnd++;
+    const char* a = p;
+    const char* b = tokEnd;
+    while (a < b && isSpace(*a)) a++;
+    while (b > a && isSpace(b[-1])) b--;
+
+    int8_t lbl = (pending < 0) ? labelIndex(a, b) : -1;
+    if (lbl >= 0) {
+      pending = lbl;
+      labeled = true;
+    } else {
+      ec_value_t f;
+      if (!parseNumber(a, b, f)) return 0;
+      if (pending >= 0) {
+        vals[pending] = f;
+        mask |= (uint8_t)(1 << pending);
+        pending = -1;
+      } else {
+        if (positional >= 4) return 0;
+        vals[positional++] = f;
+      }
+    }
+    p = tokEnd + 1;
+  }
+
+  if (labeled) {
+    if (pending >= 0 || positional != 0) return 0;
+    if (!(mask & EC_FIELD_EC)) return 0;
+  } else if (positional == 1) {
+    mask = EC_FIELD_EC;
+  } else if (positional == 4) {
+    mask = EC_FIELD_EC | EC_FIELD_TDS | EC_FIELD_SAL | EC_FIELD_SG;
+  } else {
+    return 0;  // 2 o 3 valores sin etiquetas: ambiguo
+  }
+
+  out.ec = vals[0];
+  out.tds = vals[1];
+  out.sal = vals[2];
+  out.sg = vals[3];
+  return mask;
+}
+
+bool ezoParseValue(const char* s, uint8_t len, ec_value_t& out) {
+  return parseNumber(s, s + len, out);
+}
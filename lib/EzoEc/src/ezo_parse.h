@@ -0,0 +1,33 @@
+/*
+ * Parser de lecturas del EZO EC en una sola pasada y sin heap.
+ * Acepta el formato con etiquetas "EC,<v>,TDS,<v>,SAL,<v>,SG,<v>" y el
+ * formato sin etiquetas "ec[,tds,sal,sg]". No depende de Arduino.h para
+ * poder compilarse también en el host (ver tools/bench_parse.cpp).
+ */
+#pragma once
+#include <stdint.h>
+#include "ec_value.h"
+
+// Campos presentes en una lectura (bits de la máscara devuelta)
+enum EcField : uint8_t {
+  EC_FIELD_EC  = 1 << 0,
+  EC_FIELD_TDS = 1 << 1,
+  EC_FIELD_SAL = 1 << 2,
+  EC_FIELD_SG  = 1 << 3,
+};
+
+// Con EC_FIXED_POINT los valores van en milésimas de la unidad indicada
+struct EcReading {
+  ec_value_t ec;   // µS/cm
+  ec_value_t tds;  // ppm
+  ec_value_t sal;  // PSU (ppt)
+  ec_value_t sg;   // adimensional
+};
+
+// Interpreta len bytes de s. Devuelve la máscara EC_FIELD_* de los campos
+// presentes, o 0 si la línea no es una lectura (vacía, "*OK", "?K,..", etc.).
+// Los campos ausentes quedan en 0. out solo se modifica si devuelve != 0.
+uint8_t ezoParseLine(const char* s, uint8_t len, EcReading& out);
+
+// Interpreta un único número decimal ("84", "-1.5"). Devuelve false si no lo es.
+bool ezoParseValue(const char* s, uint8_t len, ec_value_t& out);
@@ -0,0 +1,79 @@
+#include "ezo_response.h"
+#include <Arduino.h>
+
+namespace {
+
+bool equalsNoCase(const char* s, const char* p) {
+  return strcasecmp(s, p) == 0;
+}
+
+bool startsWithNoCase(const char* s, const char* p) {
+  return strncasecmp(s, p, strlen(p)) == 0;
+}
+
+// Peor caso observado con el EZO EC por UART, con margen
+const uint16_t WORST_MS[EZO_CMD_CLASS_COUNT] = {
+  1000,  // READ
+  4000,  // CAL
+  1500,  // QUERY
+  1200,  // SET
+  3000,  // FACTORY: incluye el reinicio
+  1200,  // SLEEP
+};
+
+const char NAME_READ[] PROGMEM = "R";
+const char NAME_CAL[] PROGMEM = "Cal";
+const char NAME_QUERY[] PROGMEM = "?";
+const char NAME_SET[] PROGMEM = "Set";
+const char NAME_FACTORY[] PROGMEM = "Factory";
+const char NAME_SLEEP[] PROGMEM = "Sleep";
+const char* const NAMES[EZO_CMD_CLASS_COUNT] = {
+  NAME_READ, NAME_CAL, NAME_QUERY, NAME_SET, NAME_FACTORY, NAME_SLEEP,
+};
+
+}  // namespace
+
+EzoCmdClass ezoClassify(const char* cmd) {
+  const bool query = strchr(cmd, '?') != nullptr;
+  if (equalsNoCase(cmd, "R") || startsWithNoCase(cmd, "RT,")) return EZO_CMD_READ;
+  if (startsWithNoCase(cmd, "Cal,") && !query) return EZO_CMD_CAL;
+  if (equalsNoCase(cmd, "Factory")) return EZO_CMD_FACTORY;
+  if (equalsNoCase(cmd, "Sleep")) return EZO_CMD_SLEEP;
+  if (query || equalsNoCase(cmd, "I") || equalsNoCase(cmd, "Status")) return EZO_CMD_QUERY;
+  return EZO_CMD_SET;
+}
+
+EzoResponseShape ezoResponseShape(EzoCmdClass cls, bool uartCodes) {
+  const bool data = (cls == EZO_CMD_READ || cls == EZO_CMD_QUERY);
+  if (!uartCodes) return data ? EzoResponseShape{1, 0} : EzoResponseShape{0, 1};
+  if (cls == EZO_CMD_FACTORY) return EzoResponseShape{0, 3};  // *OK, *RS, *RE
+  return EzoResponseShape{(uint8_t)(data ? 1 : 0), 1};
+}
+
+uint16_t ezoWorstCaseMs(EzoCmdClass cls) {
+  return WORST_MS[cls < EZO_CMD_CLASS_COUNT ? cls : EZO_CMD_SET];
+}
+
+const char* ezoClassName(EzoCmdClass cls) {
+  return NAMES[cls < EZO_CMD_CLASS_COUNT ? cls : EZO_CMD_SET];
+}
+
+void EzoLatency::add(uint16_t ms) {
+  if (ms > 0x0FFF) ms = 0x0FFF;  // acota para que ×8 quepa en 16 bits
+  if (n_ == 0) {
+    srtt8_ = ms << 3;
+    rttvar4_ = ms << 1;  // desviación inicial = media / 2
+  } else {
+    int16_t err = (int16_t)ms - (int16_t)(srtt8_ >> 3);
+    srtt8_ = (uint16_t)(srtt8_ + err);
+    if (err < 0) err = -err;
+    rttvar4_ = (uint16_t)(rttvar4_ + err - (rttvar4_ >> 2));
+  }
+  if (n_ < 255) n_++;
+}
+
+uint16_t EzoLatency::timeoutMs(uint16_t worstMs) const {
+  if (n_ < EZO_LAT_MIN_SAMPLES) return worstMs;
+  const uint32_t t = (uint32_t)meanMs() + rttvar4_ + EZO_LAT_MARGIN_MS;
+  return t < worstMs ? (uint16_t)t : worstMs;
+}
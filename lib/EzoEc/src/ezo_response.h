@@ -0,0 +1,70 @@
+/*
+ * Modelo de respuesta de los comandos del EZO EC: qué líneas produce cada
+ * clase de comando y cuánto suele tardar. Por UART un comando con datos
+ * responde con la línea de datos y después un "*OK" aparte; EzoLink usa
+ * este modelo para consumir ambas y no confundir el "*OK" con la respuesta
+ * del comando siguiente.
+ */
+#pragma once
+#include <stdint.h>
+
+enum EzoCmdClass : uint8_t {
+  EZO_CMD_READ = 0,   // R, RT,<t>: lectura (~600 ms de conversión)
+  EZO_CMD_CAL,        // Cal,... (salvo Cal,?)
+  EZO_CMD_QUERY,      // consultas con datos: X,?, I, Status
+  EZO_CMD_SET,        // ajustes que solo contestan *OK
+  EZO_CMD_FACTORY,    // *OK y reinicio (*RS, *RE)
+  EZO_CMD_SLEEP,      // *SL
+  EZO_CMD_CLASS_COUNT
+};
+
+struct EzoResponseShape {
+  uint8_t dataLines;  // líneas de datos antes de los códigos
+  uint8_t codeLines;  // líneas "*XX" que cierran la transacción
+};
+
+EzoCmdClass ezoClassify(const char* cmd);
+
+// uartCodes: el transporte entrega los códigos "*OK" tras los datos (UART);
+// por I2C cada comando produce una única línea
+EzoResponseShape ezoResponseShape(EzoCmdClass cls, bool uartCodes);
+
+// Plazo de peor caso de cada clase; es el techo del plazo adaptativo
+uint16_t ezoWorstCaseMs(EzoCmdClass cls);
+
+// Nombre corto de la clase (PROGMEM) para la CLI
+const char* ezoClassName(EzoCmdClass cls);
+
+#ifndef EZO_LAT_MIN_SAMPLES
+#define EZO_LAT_MIN_SAMPLES 3      // muestras antes de fiarse de la estadística
+#endif
+#ifndef EZO_LAT_MARGIN_MS
+#define EZO_LAT_MARGIN_MS 60       // holgura sobre media + 4·desviación
+#endif
+
+// Latencia de una clase de comando: media y desviación media móviles
+// exponenciales (EWMA, como el RTO de TCP). El plazo adaptativo es
+// media + 4·desviación + margen, una cota tipo p99 que no exige guardar
+// un histograma.
+class EzoLatency {
+ public:
+  void add(uint16_t ms);
+
+  // Tras un timeout se olvida la estadística: el siguiente envío usa el
+  // plazo de peor caso y se vuelve a aprender
+  void reset() { n_ = 0; timeouts_++; }
+
+  // Plazo para el próximo envío, sin pasar de worstMs
+  uint16_t timeoutMs(uint16_t worstMs) const;
+
+  uint16_t meanMs() const { return srtt8_ >> 3; }
+  uint16_t devMs() const { return rttvar4_ >> 2; }
+  uint8_t samples() const { return n_; }
+  uint16_t timeouts() const { return timeouts_; }
+
+ private:
+  uint16_t srtt8_ = 0;    // media ×8
+  uint16_t rttvar4_ = 0;  // desviación media ×4
+  uint8_t n_ = 0;
+  uint16_t timeouts_ = 0;
+};
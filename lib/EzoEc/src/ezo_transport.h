@@ -0,0 +1,67 @@
+/*
+ * Transporte físico hacia el EZO EC. EzoLink solo ve esta interfaz, así la
+ * misma API de peticiones funciona por UART (SoftwareSerial/HardwareSerial)
+ * o por I2C (Wire).
+ */
+#pragma once
+#include <Arduino.h>
+#include "ezo_line.h"
+
+class EzoTransport {
+ public:
+  virtual void begin() = 0;
+  // Envía un comando completo (sin terminador)
+  virtual void send(const char* cmd) = 0;
+  // Entrega en rx la siguiente línea recibida, si ya hay una completa.
+  // Se llama repetidamente hasta que devuelve EZO_LINE_NONE.
+  virtual EzoLineEvent poll(EzoLineReader& rx) = 0;
+  // Descarta lo que haya pendiente de leer
+  virtual void flush() {}
+  // Tras una línea de datos llega además un código "*OK" (así es por UART)
+  virtual bool sendsCodes() const { return true; }
+  // Despierta al EZO tras "Sleep" sin enviar un comando (lo que conteste
+  // al despertar llega como línea no solicitada)
+  virtual void wake() {}
+};
+
+// UART a 9600 baudios: las respuestas son líneas terminadas en '\r'
+class EzoUartTransport : public EzoTransport {
+ public:
+  explicit EzoUartTransport(Stream& port) : port_(port) {}
+  void begin() override {}
+  void send(const char* cmd) override;
+  EzoLineEvent poll(EzoLineReader& rx) override;
+  void flush() override;
+  void wake() override { port_.write('\r'); }   // cualquier byte lo despierta
+
+ private:
+  Stream& port_;
+};
+
+// I2C: tras escribir el comando se espera el tiempo de proceso fijo del EZO
+// y luego se lee el byte de estado (1 = OK, 2 = error de sintaxis,
+// 254 = aún procesando, se reintenta). La respuesta se entrega como una
+// línea; un OK sin datos se traduce a "*OK" y un error a "*ER", igual que
+// por UART.
+class EzoI2cTransport : public EzoTransport {
+ public:
+  static const uint8_t DEFAULT_ADDR = 100;  // 0x64, dirección de fábrica del EZO EC
+
+  explicit EzoI2cTransport(uint8_t addr = DEFAULT_ADDR) : addr_(addr) {}
+  void setAddress(uint8_t addr) { addr_ = addr; }
+  uint8_t address() const { return addr_; }
+  void begin() override;
+  void send(const char* cmd) override;
+  EzoLineEvent poll(EzoLineReader& rx) override;
+  void flush() override { pending_ = false; }
+  bool sendsCodes() const override { return false; }
+  void wake() override;
+
+ private:
+  static EzoLineEvent deliver(EzoLineReader& rx, const char* text);
+
+  uint8_t addr_;
+  bool pending_ = false;     // hay una respuesta por recoger
+  bool noReply_ = false;     // el comando no genera respuesta (Sleep, Factory)
+  unsigned long readyMs_ = 0;
+};
@@ -0,0 +1,87 @@
+#include "ezo_transport.h"
+#include "ezo_response.h"
+#include <Wire.h>
+
+namespace {
+
+// Tiempos de proceso del EZO EC en modo I2C (datasheet)
+const uint16_t READ_DELAY_MS = 600;     // R, Cal
+const uint16_t DEFAULT_DELAY_MS = 300;  // resto de comandos
+const uint16_t RETRY_MS = 50;           // reintento si el estado es 254
+
+const uint8_t ST_OK = 1;
+const uint8_t ST_SYNTAX = 2;
+const uint8_t ST_BUSY = 254;
+
+}  // namespace
+
+void EzoI2cTransport::begin() {
+  Wire.begin();
+}
+
+void EzoI2cTransport::send(const char* cmd) {
+  Wire.beginTransmission(addr_);
+  Wire.write((const uint8_t*)cmd, strlen(cmd));
+  Wire.endTransmission();
+
+  const EzoCmdClass cls = ezoClassify(cmd);
+  const bool slow = (cls == EZO_CMD_READ || cls == EZO_CMD_CAL);
+  readyMs_ = millis() + (slow ? READ_DELAY_MS : DEFAULT_DELAY_MS);
+  noReply_ = (cls == EZO_CMD_SLEEP || cls == EZO_CMD_FACTORY);
+  pending_ = true;
+}
+
+void EzoI2cTransport::wake() {
+  // Cualquier transacción dirigida al EZO lo despierta
+  Wire.beginTransmission(addr_);
+  Wire.endTransmission();
+}
+
+EzoLineEvent EzoI2cTransport::deliver(EzoLineReader& rx, const char* text) {
+  rx.reset();
+  while (*text) (void)rx.feed(*text++);
+  return rx.feed('\r');
+}
+
+EzoLineEvent EzoI2cTransport::poll(EzoLineReader& rx) {
+  if (!pending_) return EZO_LINE_NONE;
+  if (noReply_) {
+    pending_ = false;
+    return deliver(rx, "*OK");  // el EZO se duerme/reinicia sin contestar
+  }
+  if ((long)(millis() - readyMs_) < 0) return EZO_LINE_NONE;
+
+  // El buffer de Wire en AVR es de 32 bytes: respuestas más largas se truncan
+  const uint8_t n = Wire.requestFrom(addr_, (uint8_t)32);
+  if (n == 0) {
+    readyMs_ = millis() + RETRY_MS;  // sin ACK: se reintenta hasta el plazo de EzoLink
+    return EZO_LINE_NONE;
+  }
+  const uint8_t status = (uint8_t)Wire.read();
+  if (status == ST_BUSY) {
+    while (Wire.available()) (void)Wire.read();
+    readyMs_ = millis() + RETRY_MS;
+    return EZO_LINE_NONE;
+  }
+  pending_ = false;
+  if (status == ST_SYNTAX) {
+    while (Wire.available()) (void)Wire.read();
+    return deliver(rx, "*ER");
+  }
+  if (status != ST_OK) {
+    while (Wire.available()) (void)Wire.read();
+    return EZO_LINE_NONE;  // 255 = sin datos: vencerá el plazo
+  }
+
+  rx.reset();
+  bool terminated = false;
+  while (Wire.available()) {
+    const char c = (char)Wire.read();
+    if (c == '\0') { terminated = true; break; }
+    (void)rx.feed(c);
+  }
+  while (Wire.available()) (void)Wire.read();
+  if (rx.length() == 0) return deliver(rx, "*OK");
+  if (!terminated) rx.markOverflow();  // no cupo el terminador en 32 bytes
+  return rx.feed('\r');
+}
@@ -0,0 +1,19 @@
+#include "ezo_transport.h"
+
+void EzoUartTransport::send(const char* cmd) {
+  port_.print(cmd);
+  port_.print('\r');  // Atlas EZO requiere '\r' como terminador
+}
+
+EzoLineEvent EzoUartTransport::poll(EzoLineReader& rx) {
+  // Lee hasta '\r'; el lector filtra caracteres no ASCII imprimibles
+  while (port_.available()) {
+    EzoLineEvent ev = rx.feed((char)port_.read());
+    if (ev != EZO_LINE_NONE) return ev;
+  }
+  return EZO_LINE_NONE;
+}
+
+void EzoUartTransport::flush() {
+  while (port_.available()) (void)port_.read();
+}
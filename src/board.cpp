@@ -0,0 +1,130 @@
+#include "board.h"
+#include <EEPROM.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+namespace {
+SemaphoreHandle_t lock = nullptr;
+void (*taskFn)() = nullptr;
+
+void taskMain(void*) {
+  for (;;) {
+    taskFn();
+    vTaskDelay(1);   // cede el núcleo (y el watchdog de la tarea idle)
+  }
+}
+}  // namespace
+
+Stream& boardEzoSerial() { return Serial2; }
+void boardEzoSerialBegin(unsigned long baud) { Serial2.begin(baud, SERIAL_8N1, EZO_UART_RX, EZO_UART_TX); }
+bool boardEzoSerialOverflow() { return false; }
+
+void boardEepromBegin() { EEPROM.begin(512); }
+void boardEepromCommit() { EEPROM.commit(); }
+
+void boardRamPaint() {}
+uint32_t boardFreeRamMin() { return ESP.getMinFreeHeap(); }
+
+bool boardStartTask(void (*fn)()) {
+  taskFn = fn;
+  // el mutex se crea aquí, antes de que exista el segundo hilo: crearlo al
+  // primer uso dejaba que cada núcleo creara el suyo
+  if (!lock) lock = xSemaphoreCreateMutex();
+  if (!lock) return false;
+  // la CLI sigue en loop() (núcleo 1); la adquisición va al núcleo 0
+  return xTaskCreatePinnedToCore(taskMain, "ezo", 4096, nullptr, 1, nullptr, 0) == pdPASS;
+}
+
+// Antes de boardStartTask() solo corre setup(): sin mutex no hay nada que excluir
+void boardLock() {
+  if (lock) xSemaphoreTake(lock, portMAX_DELAY);
+}
+void boardUnlock() {
+  if (lock) xSemaphoreGive(lock);
+}
+
+#elif defined(ARDUINO_ARCH_RP2040)
+
+#include <pico/mutex.h>
+
+namespace {
+auto_init_mutex(lock);
+void (*volatile taskFn)() = nullptr;
+}  // namespace
+
+// Segundo núcleo (arduino-pico): espera a que setup() registre la tarea
+void loop1() {
+  if (taskFn) taskFn();
+}
+
+Stream& boardEzoSerial() { return Serial1; }
+void boardEzoSerialBegin(unsigned long baud) {
+  Serial1.setRX(EZO_UART_RX);
+  Serial1.setTX(EZO_UART_TX);
+  Serial1.begin(baud);
+}
+bool boardEzoSerialOverflow() { return Serial1.overflow(); }
+
+void boardEepromBegin() { EEPROM.begin(512); }
+void boardEepromCommit() { EEPROM.commit(); }
+
+void boardRamPaint() {}
+uint32_t boardFreeRamMin() { return rp2040.getFreeHeap(); }
+
+bool boardStartTask(void (*fn)()) {
+  taskFn = fn;
+  return true;
+}
+
+void boardLock() { mutex_enter_blocking(&lock); }
+void boardUnlock() { mutex_exit(&lock); }
+
+#else
+
+#if !EZO_TRANSPORT_I2C
+#include <SoftwareSerial.h>
+
+namespace {
+SoftwareSerial ezoSerial(EZO_UART_RX, EZO_UART_TX);
+}  // namespace
+
+Stream& boardEzoSerial() { return ezoSerial; }
+void boardEzoSerialBegin(unsigned long baud) { ezoSerial.begin(baud); }
+bool boardEzoSerialOverflow() { return ezoSerial.overflow(); }
+#endif
+
+void boardEepromBegin() {}
+void boardEepromCommit() {}   // EEPROM real: put() ya escribe
+
+#if defined(__AVR__)
+extern char __heap_start;
+extern char* __brkval;
+
+namespace {
+const uint8_t RAM_PAINT = 0xA5;
+const uint8_t RAM_PAINT_MARGIN = 32;   // bytes bajo SP que no se pintan (marco actual)
+
+uint8_t* ramFloor() { return (uint8_t*)(__brkval ? __brkval : &__heap_start); }
+}  // namespace
+
+void boardRamPaint() {
+  uint8_t* const top = (uint8_t*)SP - RAM_PAINT_MARGIN;
+  for (uint8_t* p = ramFloor(); p < top; p++) *p = RAM_PAINT;
+}
+
+// Bytes pintados contiguos desde el final del heap: la pila nunca bajó de ahí
+uint32_t boardFreeRamMin() {
+  const uint8_t* p = ramFloor();
+  const uint8_t* const top = (const uint8_t*)SP;
+  uint32_t n = 0;
+  while (p + n < top && p[n] == RAM_PAINT) n++;
+  return n;
+}
+#else
+void boardRamPaint() {}
+uint32_t boardFreeRamMin() { return 0; }
+#endif
+
+bool boardStartTask(void (*)()) { return false; }
+
+#endif
@@ -0,0 +1,104 @@
+#include "cli.h"
+
+namespace {
+
+const unsigned long IDLE_MS = 300;
+
+const char USAGE_PREFIX[] PROGMEM = "[CLI] Uso: ";
+const char UNKNOWN_PREFIX[] PROGMEM = "[CLI] Comando desconocido: ";
+
+}  // namespace
+
+uint8_t cliTokenize(char* line, char** argv, uint8_t maxTokens) {
+  uint8_t n = 0;
+  char* p = line;
+  while (*p) {
+    while (*p == ' ' || *p == '\t') *p++ = '\0';
+    if (!*p) break;
+    if (n < maxTokens) argv[n] = p;
+    n++;
+    if (n > maxTokens) break;
+    while (*p && *p != ' ' && *p != '\t') p++;
+  }
+  return n;
+}
+
+CliResult cliDispatch(const CliCommand* table, uint8_t count, char* line, Print& out) {
+  char* argv[CLI_MAX_ARGS + 1];
+  const uint8_t argc = cliTokenize(line, argv, CLI_MAX_ARGS + 1);
+  if (argc == 0) return CLI_EMPTY;
+
+  for (uint8_t i = 0; i < count; i++) {
+    CliCommand c;
+    memcpy_P(&c, &table[i], sizeof(c));
+    if (strcasecmp_P(argv[0], c.name) != 0) continue;
+    const uint8_t nargs = argc - 1;
+    if (nargs < c.minArgs || nargs > c.maxArgs) {
+      out.print(reinterpret_cast<const __FlashStringHelper*>(USAGE_PREFIX));
+      out.println(reinterpret_cast<const __FlashStringHelper*>(c.usage));
+      return CLI_USAGE;
+    }
+    c.handler(argc, argv);
+    return CLI_OK;
+  }
+  out.print(reinterpret_cast<const __FlashStringHelper*>(UNKNOWN_PREFIX));
+  out.println(argv[0]);
+  return CLI_UNKNOWN;
+}
+
+char* CliLineBuffer::poll(Stream& in, unsigned long nowMs) {
+  if (ready_) {
+    clear();
+    ready_ = false;
+  }
+  bool terminated = false;
+  while (in.available()) {
+    const char c = (char)in.read();
+    if (c == '\n' || c == '\r') {  // acepta LF o CR como fin de línea
+      terminated = true;
+      break;
+    }
+    lastByteMs_ = nowMs;
+    if (len_ >= CLI_LINE_MAX) { overflow_ = true; continue; }
+    buf_[len_++] = c;
+    buf_[len_] = '\0';
+  }
+  // procesa si hubo terminador o si no llegan más bytes en ~300 ms
+  const bool idle = (len_ > 0) && (nowMs - lastByteMs_ > IDLE_MS);
+  if (!(terminated || idle) || (len_ == 0 && !overflow_)) return nullptr;
+  ready_ = true;
+  overflowed_ = overflow_;
+  return buf_;
+}
+
+bool CliBatch::append(const char* line) {
+  const uint8_t len0 = len_, count0 = count_;
+  const char* p = line;
+  while (*p) {
+    while (*p == ' ' || *p == '\t' || *p == ';') p++;
+    if (!*p) break;
+    const char* end = p;
+    while (*end && *end != ';') end++;
+    const char* tail = end;
+    while (tail > p && (tail[-1] == ' ' || tail[-1] == '\t')) tail--;
+    const uint16_t n = (uint16_t)(tail - p);
+    if (len_ + n + 1 > CLI_BATCH_MAX) {
+      len_ = len0;
+      count_ = count0;
+      return false;
+    }
+    memcpy(buf_ + len_, p, n);
+    len_ += n;
+    buf_[len_++] = '\0';
+    count_++;
+    p = end;
+  }
+  return true;
+}
+
+char* CliBatch::next() {
+  if (pos_ >= len_) return nullptr;
+  char* line = buf_ + pos_;
+  pos_ += (uint8_t)(strlen(line) + 1);
+  return line;
+}
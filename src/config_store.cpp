@@ -0,0 +1,53 @@
+#include "config_store.h"
+#include <EEPROM.h>
+#include "crc8.h"
+#include "board.h"
+
+namespace {
+
+const uint8_t MAGIC0 = 'E';
+const uint8_t MAGIC1 = 'C';
+const int ADDR = 0;
+
+struct Header {
+  uint8_t magic[2];
+  uint8_t version;
+  uint8_t size;
+  uint8_t crc;   // CRC-8 de Settings
+};
+
+bool sameAsStored(int addr, const void* data, uint16_t n) {
+  const uint8_t* p = (const uint8_t*)data;
+  for (uint16_t i = 0; i < n; i++) {
+    if (EEPROM.read(addr + i) != p[i]) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool settingsLoad(Settings& out) {
+  Header h;
+  EEPROM.get(ADDR, h);
+  if (h.magic[0] != MAGIC0 || h.magic[1] != MAGIC1) return false;
+  if (h.version != CONFIG_VERSION || h.size != sizeof(Settings)) return false;
+  Settings s;
+  EEPROM.get(ADDR + (int)sizeof(Header), s);
+  if (crc8((const uint8_t*)&s, sizeof(s)) != h.crc) return false;
+  out = s;
+  return true;
+}
+
+void settingsSave(const Settings& in) {
+  Header h;
+  h.magic[0] = MAGIC0;
+  h.magic[1] = MAGIC1;
+  h.version = CONFIG_VERSION;
+  h.size = sizeof(Settings);
+  h.crc = crc8((const uint8_t*)&in, sizeof(in));
+  // Sin cambios no se toca nada: en flash emulada commit() reescribe el sector
+  if (sameAsStored(ADDR, &h, sizeof(h)) && sameAsStored(ADDR + (int)sizeof(Header), &in, sizeof(in))) return;
+  EEPROM.put(ADDR + (int)sizeof(Header), in);
+  EEPROM.put(ADDR, h);
+  boardEepromCommit();
+}
@@ -0,0 +1,50 @@
+#include <Arduino.h>
+#include "ec_derived.h"
+
+namespace {
+
+// PSS-78 a t = 25 °C (C(35,15,0) = 42.914 mS/cm, r_t(25) = 1.2365) y la
+// extensión de Hill et al. (1986) por debajo de 2 PSU. Nodos elegidos para
+// que el error de interpolación quede por debajo de 0.013 PSU.
+const EcLutPoint SAL_TABLE[] PROGMEM = {
+  {     0,     0 }, {    50,    22 }, {   100,    46 }, {   250,   118 },
+  {   500,   240 }, {  1000,   492 }, {  2000,  1017 }, {  3000,  1559 },
+  {  4000,  2114 }, {  5000,  2680 }, {  7500,  4132 }, { 10000,  5627 },
+  { 12500,  7158 }, { 15000,  8718 }, { 20000, 11917 }, { 25000, 15205 },
+  { 30000, 18572 }, { 35000, 22013 }, { 40000, 25522 }, { 45000, 29098 },
+  { 50000, 32738 }, { 55000, 36441 }, { 60000, 40207 },
+};
+const uint8_t SAL_TABLE_LEN = sizeof(SAL_TABLE) / sizeof(SAL_TABLE[0]);
+
+EcLutPoint lutAt(const EcLutPoint* table, uint8_t i) {
+  EcLutPoint p;
+  memcpy_P(&p, &table[i], sizeof(p));
+  return p;
+}
+
+}  // namespace
+
+int32_t ecLutInterp(const EcLutPoint* table, uint8_t n, int32_t xMilli) {
+  // Tramo [i-1, i] que contiene x; búsqueda lineal, las tablas son cortas
+  uint8_t i = 1;
+  EcLutPoint a = lutAt(table, 0), b = lutAt(table, 1);
+  while (i + 1 < n && xMilli > (int32_t)b.x * 1000) {
+    a = b;
+    b = lutAt(table, ++i);
+  }
+  const int32_t x0 = (int32_t)a.x * 1000, dx = ((int32_t)b.x - a.x) * 1000;
+  const int64_t num = (int64_t)((int32_t)b.y - a.y) * (xMilli - x0);
+  const int32_t y = (int32_t)a.y + (int32_t)((num + (num >= 0 ? dx / 2 : -dx / 2)) / dx);
+  return y < 0 ? 0 : y;
+}
+
+int32_t ecSalinityMilli(int32_t ecMilli) {
+  if (ecMilli <= 0) return 0;
+  return ecLutInterp(SAL_TABLE, SAL_TABLE_LEN, ecMilli);
+}
+
+int32_t ecResistivityMilli(int32_t ecMilli) {
+  if (ecMilli <= 0) return EC_RES_OPEN;
+  // ρ [MΩ·cm] = 1 / EC [µS/cm]  →  milésimas: 10^6 / ecMilli
+  return (1000000L + ecMilli / 2) / ecMilli;
+}
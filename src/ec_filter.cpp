@@ -0,0 +1,57 @@
+#include "ec_filter.h"
+
+void EcFilter::configure(EcFilterMode mode, uint8_t n, uint8_t decim) {
+  mode_ = mode;
+  const uint8_t maxN = (mode == EC_FILTER_EWMA) ? 255 : EC_FILTER_MAX;
+  n_ = (n == 0) ? 1 : (n > maxN ? maxN : n);
+  decim_ = (decim == 0) ? 1 : decim;
+  reset();
+}
+
+void EcFilter::reset() {
+  head_ = count_ = phase_ = 0;
+  primed_ = false;
+}
+
+int32_t EcFilter::mean() const {
+  int64_t sum = 0;   // 16 × 2·10^8 milésimas no cabe en int32
+  for (uint8_t i = 0; i < count_; i++) sum += ring_[i];
+  const int64_t half = (sum < 0 ? -count_ : count_) / 2;
+  return (int32_t)((sum + half) / count_);
+}
+
+int32_t EcFilter::median() const {
+  int32_t v[EC_FILTER_MAX];
+  for (uint8_t i = 0; i < count_; i++) {   // inserción: n <= 16
+    const int32_t x = ring_[i];
+    uint8_t j = i;
+    for (; j > 0 && v[j - 1] > x; j--) v[j] = v[j - 1];
+    v[j] = x;
+  }
+  const uint8_t mid = count_ / 2;
+  if (count_ & 1) return v[mid];
+  return v[mid - 1] + (v[mid] - v[mid - 1]) / 2;
+}
+
+bool EcFilter::push(int32_t milli, int32_t& out) {
+  int32_t y = milli;
+  if (mode_ == EC_FILTER_EWMA) {
+    if (!primed_) {
+      ewma_ = milli;
+      primed_ = true;
+    } else {
+      const int32_t d = milli - ewma_;
+      ewma_ += (d + (d < 0 ? -(int32_t)(n_ / 2) : (int32_t)(n_ / 2))) / n_;
+    }
+    y = ewma_;
+  } else if (mode_ != EC_FILTER_OFF) {
+    ring_[head_] = milli;
+    head_ = (uint8_t)((head_ + 1) % n_);
+    if (count_ < n_) count_++;
+    y = (mode_ == EC_FILTER_MEAN) ? mean() : median();
+  }
+  if (++phase_ < decim_) return false;
+  phase_ = 0;
+  out = y;
+  return true;
+}
@@ -0,0 +1,57 @@
+#include "ec_stability.h"
+
+namespace {
+
+uint32_t isqrt64(uint64_t v) {
+  uint64_t r = 0, bit = (uint64_t)1 << 62;
+  while (bit > v) bit >>= 2;
+  while (bit) {
+    if (v >= r + bit) { v -= r + bit; r = (r >> 1) + bit; }
+    else r >>= 1;
+    bit >>= 2;
+  }
+  return (uint32_t)r;
+}
+
+}  // namespace
+
+void EcStability::configure(uint8_t n, uint16_t permille, int32_t floorMilli) {
+  n_ = (n < 3) ? 3 : (n > EC_STABLE_MAX ? EC_STABLE_MAX : n);
+  permille_ = permille;
+  floor_ = floorMilli;
+  reset();
+}
+
+bool EcStability::push(int32_t milli) {
+  ring_[head_] = milli;
+  head_ = (uint8_t)((head_ + 1) % n_);
+  if (count_ < n_) count_++;
+
+  // En orden temporal y relativo a la más antigua, para que los productos
+  // quepan en int64 con lecturas de hasta 2·10^8 milésimas
+  const uint8_t n = count_;
+  const uint8_t first = (count_ < n_) ? 0 : head_;
+  const int32_t x0 = ring_[first];
+  int64_t sx = 0, sxx = 0, six = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    const int64_t x = (int64_t)ring_[(first + i) % n_] - x0;
+    sx += x;
+    sxx += x * x;
+    six += (int64_t)i * x;
+  }
+  const int64_t si = (int64_t)n * (n - 1) / 2;
+  const int64_t sii = (int64_t)(n - 1) * n * (2 * n - 1) / 6;
+
+  mean_ = (int32_t)(x0 + sx / n);
+  const int64_t var = (n * sxx - sx * sx) / ((int64_t)n * n);
+  sigma_ = (int32_t)isqrt64(var > 0 ? (uint64_t)var : 0);
+  const int64_t den = n * sii - si * si;   // > 0 con n >= 2
+  drift_ = (den > 0) ? (int32_t)((n * six - si * sx) * (n - 1) / den) : 0;
+
+  const int32_t absMean = mean_ < 0 ? -mean_ : mean_;
+  tol_ = (int32_t)((int64_t)absMean * permille_ / 1000);
+  if (tol_ < floor_) tol_ = floor_;
+
+  const int32_t absDrift = drift_ < 0 ? -drift_ : drift_;
+  return count_ == n_ && absDrift <= tol_ && sigma_ <= tol_;
+}
@@ -2,156 +2,845 @@
 /*
  * Lectura del sensor EZO EC (Atlas Scientific) en Arduino Uno
  * Aplicación: agua destilada de laboratorio
- * Usa SoftwareSerial para liberar el puerto USB (Serial) para depuración.
+ * Usa SoftwareSerial (o I2C) para liberar el puerto USB (Serial) para depuración.
  * Configura TDS, Salinidad (SAL) y Gravedad Específica (SG) una sola vez.
+ * También compila para ESP32 y RP2040 (ver board.h): UART hardware y la
+ * adquisición en su propia tarea.
  */
 #include <Arduino.h>
-#include <SoftwareSerial.h>
-// static const float TDS_FACTOR = 0.5;
-// Conversión EC (µS/cm) → TDS/Salinidad (ppm/ppt)
-static const float TDS_PPM_FACTOR = 0.5;    // usa 0.7f si prefieres escala 700
-static const float SAL_PPM_FACTOR = 0.0005; // salinidad (ppm) ≈ EC * factor
-SoftwareSerial ezoSerial(3, 2);  // D3=RX (desde EZO TX), D2=TX (hacia EZO RX)
-bool outputsConfigured = false;
-unsigned long lastReadMs = 0;
-bool streamingEnabled = false;
+#include "board.h"
+#include "ezo_link.h"
+#include "ezo_grid.h"
+#include "ezo_cache.h"
+#include "ezo_health.h"
+#include "ezo_parse.h"
+#include "ec_frame.h"
+#include "log.h"
+#include "sample_ring.h"
+#include "config_store.h"
+#include "cli.h"
+#include "temp_sensor.h"
+#include "perf.h"
+#include "ec_filter.h"
+#include "power.h"
+#include "ec_stability.h"
+#include "ec_derived.h"
+#include "net_sink.h"
+#include "feature_set.h"
+// Transporte hacia el EZO: UART (SoftwareSerial en el Uno) o I2C con
+// -DEZO_TRANSPORT_I2C=1 (A4=SDA, A5=SCL; deja libres D2/D3 y no bloquea
+// interrupciones mientras llegan bytes). El EZO debe estar en el mismo modo.
+// Por I2C se pueden manejar varias sondas a la vez, una por dirección:
+// -DEZO_I2C_ADDRS=100,101,102. Sus conversiones de ~600 ms se solapan, así
+// que el ciclo completo dura casi lo mismo que con una sola sonda.
+#if EZO_TRANSPORT_I2C
+#ifndef EZO_I2C_ADDRS
+#define EZO_I2C_ADDRS EzoI2cTransport::DEFAULT_ADDR
+#endif
+static const uint8_t PROBE_ADDRS[] = { EZO_I2C_ADDRS };
+static const uint8_t PROBE_COUNT = sizeof(PROBE_ADDRS);
+EzoI2cTransport ezoPorts[PROBE_COUNT];
+#else
+// SoftwareSerial solo escucha un puerto a la vez: una sola sonda por UART
+// (pines en board.h: D3=RX desde EZO TX, D2=TX hacia EZO RX)
+static const uint8_t PROBE_COUNT = 1;
+EzoUartTransport ezoPorts[PROBE_COUNT] = { EzoUartTransport(boardEzoSerial()) };
+#endif
+static_assert(PROBE_COUNT <= EZO_PROBE_MAX, "demasiadas sondas para la configuración");
+
 unsigned long readPeriodMs = 1000;
 bool printRaw = false;
+uint8_t logLevel = (LOG_LEVEL_MAX < LOG_INFO) ? LOG_LEVEL_MAX : LOG_INFO;
+
+// Formato de salida de las muestras por USB (las respuestas de la CLI siguen en texto)
+// (solo los compilados en OUT_FORMATS, ver feature_set.h)
+enum OutFormat : uint8_t { OUT_TEXT, OUT_BIN, OUT_CSV };
+OutFormat outFormat = (OutFormat)Features::defaultFormat();
+// Constante en compilación si el formato no está en el binario
+static inline bool outIs(OutFormat f) { return Features::format(f) && outFormat == f; }
+// Columnas de texto/csv activas ("derive"; SG depende de "o sg"), dentro de
+// las que se compilaron en SAMPLE_FIELDS
+uint8_t sampleFields = Features::fields;
+static inline bool showField(uint8_t bit) { return Features::field(bit) && (sampleFields & bit); }
+uint16_t sampleSeq = 0;         // secuencia de muestras emitidas (todas las sondas)
+SampleRing<SAMPLE_RING_LEN> sampleRing;  // últimas muestras, para "dump"
+#if NET_SINK
+// Envío por red (net_sink.h): lee del mismo buffer, sin copia por muestra
+SampleBatcher netBatcher;
+#endif
+
+// Compensación automática de temperatura: solo se reenvía T al EZO cuando
+// la temperatura local se aleja más de la banda muerta de la última enviada
+#ifndef TEMP_DEADBAND_CENTI
+#define TEMP_DEADBAND_CENTI 20   // 0.20 °C
+#endif
+// Filtro de EC entre el parser y la salida (igual para todas las sondas)
+EcFilterMode filterMode = EC_FILTER_OFF;
+uint8_t filterLen = 1;
+uint8_t decimation = 1;
+
+// "stream delta": se muestrea a ritmo completo pero solo se emite una
+// muestra si EC se mueve al menos deltaMilli desde la última emitida, o si
+// pasan heartbeatS segundos sin emitir (para que el host sepa que vive)
+int32_t deltaMilli = 0;           // 0 = se emiten todas
+uint16_t heartbeatS = 60;
+
+// Modo de bajo consumo por ciclos ("duty"): cada dutyPeriodS segundos se
+// despierta el EZO, se toman dutyReadings lecturas, se le manda "Sleep" y el
+// ATmega queda en power-down hasta el ciclo siguiente. La CLI solo se
+// atiende mientras el ciclo está activo.
+enum DutyState : uint8_t { DUTY_OFF, DUTY_WAKE, DUTY_READ, DUTY_SLEEP };
+struct DutyCycle {
+  DutyState state = DUTY_OFF;
+  unsigned long cycleMs = 0;   // inicio del ciclo en curso (rejilla fija)
+  unsigned long stateMs = 0;
+  uint8_t taken = 0;           // lecturas pedidas en este ciclo
+  uint32_t cycles = 0;
+};
+DutyCycle duty;
+uint16_t dutyPeriodS = 0;
+uint8_t dutyReadings = 1;
+
+bool tempAuto = TEMP_SENSOR;
+uint16_t tempDeadbandCenti = TEMP_DEADBAND_CENTI;
+#if TEMP_SENSOR
+Ds18b20 tempSensor(TEMP_DS18B20_PIN);
+#endif
+
+// Estado de cada circuito EZO; los callbacks lo recuperan con link.id()
+struct Probe {
+  EzoLink link;
+  bool outputsConfigured = false;
+  bool outputsQueued = false;
+  uint8_t configRemaining = 0;
+  uint8_t configGen = 0;             // cambia al reconfigurar: descarta respuestas viejas
+  uint8_t outputMask = EC_FIELD_EC;  // salidas deseadas (y última conocida) del EZO
+  bool streamingEnabled = false;
+  bool readInFlight = false;         // hay un R del streaming esperando respuesta
+  EzoReadGrid grid;                  // rejilla de envíos de R del streaming
+
+  // Modo continuo del EZO (C,n): el EZO emite una lectura cada n segundos sin
+  // que se le pida; se consumen en onEzoLine() sin ida y vuelta por muestra
+  bool continuousMode = false;
+  uint8_t continuousSec = 1;
+  unsigned long contLastMs = 0;      // llegada de la última lectura continua
+  uint32_t contSamples = 0;
+  uint32_t contDropped = 0;          // lecturas perdidas (huecos o desborde del RX)
+  uint32_t contMerged = 0;           // líneas fundidas/truncadas no interpretables
+
+  int16_t tempSentCenti = TEMP_NONE;  // última T aceptada por el EZO
+  int16_t tempInFlight = TEMP_NONE;   // T (o RT) enviada y aún sin respuesta
+  bool noRt = false;                  // el firmware rechazó RT: T va aparte
+
+  EcFilter filter;                    // filtro/decimación de EC de esta sonda
+  EzoQueryCache cache;                // respuestas de K,? O,? Cal,? I Status
+  EzoHealth health;                   // códigos de error, timeouts y espera tras caída
+  EzoHealthState healthShown = EZO_HEALTH_OK;   // último estado notificado
+
+  bool emitted = false;               // hay referencia para stream delta
+  int32_t lastEmitMilli = 0;          // EC de la última muestra emitida
+  unsigned long lastEmitMs = 0;
+  uint32_t suppressed = 0;            // muestras omitidas por stream delta
+};
 
-static void ezoSend(const char* cmd) {
-  ezoSerial.print(cmd);
-  ezoSerial.print('\r');  // Atlas EZO requiere '\r' como terminador
+Probe probes[PROBE_COUNT];
+uint8_t selProbe = 0;                // sonda a la que van los comandos de la CLI
+
+static inline Probe& probeOf(EzoLink& link) { return probes[link.id()]; }
+static inline Probe& cur() { return probes[selProbe]; }
+
+// Modo batch: las líneas entre "batch begin" y "batch end" (o separadas por
+// ';' en una sola línea) se guardan y se ejecutan en orden. Cada línea se
+// despacha en cuanto el EZO respondió a la anterior, no tras un timeout fijo;
+// el primer fallo detiene el guion y al final se da un único estado.
+struct BatchState {
+  bool recording = false;
+  bool overflow = false;       // alguna línea grabada no cupo en el guion
+  bool running = false;
+  bool failed = false;
+  uint8_t lines = 0;           // líneas ya despachadas
+  uint8_t inFlight = 0;        // comandos EZO del batch sin respuesta
+  uint8_t ezoOk = 0;           // respuestas EZO correctas
+  unsigned long startMs = 0;
+  char failedCmd[EzoLink::CMD_MAX];
+};
+static BatchState batch;
+static CliBatch batchScript;
+
+// Calibración guiada ("cal auto <punto> [<v>]"): se piden R seguidos hasta
+// que la ventana de lecturas es estable (deriva y desviación bajo la
+// tolerancia) y solo entonces se envía Cal,<punto>,<v> y se verifica con
+// Cal,?. Mientras tanto el streaming de esa sonda queda en pausa.
+#ifndef CAL_STABLE_N
+#define CAL_STABLE_N 10          // lecturas de la ventana (~6 s)
+#endif
+#ifndef CAL_STABLE_PERMILLE
+#define CAL_STABLE_PERMILLE 5    // tolerancia: 0.5 % del valor
+#endif
+static const int32_t CAL_STABLE_FLOOR_MILLI = 1000;          // mínimo 1 µS/cm (en seco)
+static const unsigned long CAL_GUIDE_TIMEOUT_MS = 600000UL;  // 10 min sin estabilizar
+
+enum CalStage : uint8_t { CAL_IDLE, CAL_SAMPLING, CAL_SETTING, CAL_VERIFYING };
+struct CalGuide {
+  CalStage stage = CAL_IDLE;
+  uint8_t probe = 0;
+  bool readInFlight = false;
+  unsigned long startMs = 0;
+  char cmd[EzoLink::CMD_MAX];   // Cal,<punto>[,<v>] a enviar al estabilizar
+  EcStability stab;
+};
+static CalGuide calGuide;
+
+// Prefijo de los mensajes del EZO; con varias sondas indica cuál
+static void printTag(const __FlashStringHelper* tag, uint8_t probe) {
+  Serial.print('[');
+  Serial.print(tag);
+  if (PROBE_COUNT > 1) { Serial.print(' '); Serial.print(probe); }
+  Serial.print(F("] "));
 }
 
-// Lee hasta '\r' y filtra caracteres no ASCII imprimibles
-static String ezoReadLine(uint16_t timeoutMs = 500) {
-  String line;
-  unsigned long start = millis();
-  while (millis() - start < timeoutMs) {
-    while (ezoSerial.available()) {
-      char c = (char)ezoSerial.read();
-      if (c == '\r') {
-        return line;
-      }
-      if (c >= 32 && c <= 126) {
-        line += c;
-      }
+// Muestra claramente la petición y su respuesta. El envío solo se ve en
+// LOG_DEBUG; la respuesta con el nivel indicado, o LOG_ERR si falló.
+static void printExchange(EzoLink& link, EzoStatus status, const char* cmd, const char* resp,
+                          uint8_t len, uint8_t level = LOG_INFO) {
+  if (LOG_ENABLED(LOG_DEBUG)) {
+    printTag(F("EZO"), link.id());
+    Serial.print(F("Enviando: "));
+    Serial.println(cmd);
+  }
+  if (len == 0 || status != EZO_OK) level = LOG_ERR;
+  if (!LOG_ENABLED(level)) return;
+  printTag(F("EZO"), link.id());
+  Serial.print(F("Respuesta: "));
+  if (len == 0) {
+    Serial.println(F("(timeout)"));
+  } else {
+    Serial.print(resp);
+    if (status == EZO_TIMEOUT) Serial.println(F(" (incompleta)"));
+    else if (status == EZO_TRUNCATED) Serial.println(F(" (truncada)"));
+    else Serial.println();
+  }
+}
+
+// Anota el primer fallo del batch en curso; detiene el resto del guion
+static void batchFail(const char* what) {
+  if (!batch.running || batch.failed) return;
+  batch.failed = true;
+  strncpy(batch.failedCmd, what, sizeof(batch.failedCmd) - 1);
+  batch.failedCmd[sizeof(batch.failedCmd) - 1] = '\0';
+}
+
+// Cuenta la respuesta a un comando de la CLI si pertenece al batch en curso
+static void batchNote(EzoStatus status, const char* cmd, const char* resp, uint8_t len) {
+  if (!batch.running || batch.inFlight == 0) return;
+  batch.inFlight--;
+  if (status == EZO_OK && len > 0 && strncmp(resp, "*ER", 3) != 0) batch.ezoOk++;
+  else batchFail(cmd);
+}
+
+// Callback por defecto para comandos de la CLI: solo informa el resultado
+static void onCliDone(EzoLink& link, EzoStatus status, const char* cmd, const char* resp, uint8_t len, void*) {
+  if (status == EZO_TIMEOUT) perfCount(PERF_TIMEOUT);
+  printExchange(link, status, cmd, resp, len);
+  batchNote(status, cmd, resp, len);
+}
+
+// Encola un comando de la CLI en la sonda seleccionada sin bloquear
+static bool cliSubmit(const char* cmd, uint16_t timeoutMs, EzoDoneFn done, void* ctx = nullptr) {
+  if (!cur().link.submit(cmd, timeoutMs, done, ctx)) {
+    if (LOG_ENABLED(LOG_ERR)) {
+      Serial.print(F("[EZO] Cola llena, descartado: "));
+      Serial.println(cmd);
     }
+    batchFail(cmd);
+    return false;
   }
-  return line;  // puede ser vacío si expiró
+  if (batch.running) batch.inFlight++;
+  return true;
 }
 
-// Envía un comando al EZO y etiqueta claramente la petición y su respuesta
-static String ezoQuery(const char* cmd, uint16_t timeoutMs = 1000) {
-  Serial.print("[EZO] Enviando: ");
-  Serial.println(cmd);
-  ezoSend(cmd);
-  String resp = ezoReadLine(timeoutMs);
-  Serial.print("[EZO] Respuesta: ");
-  if (resp.length() == 0) {
-    Serial.println("(timeout)");
-  } else {
-    Serial.println(resp);
+// Encola un comando sin bloquear; la respuesta se imprime cuando llegue
+static void ezoSubmit(const char* cmd) {
+  cliSubmit(cmd, EZO_TIMEOUT_AUTO, onCliDone);
+}
+
+// Consulta idempotente (ezo_cache.h): se contesta desde la caché si hay
+// dato; refresh ("?!") obliga a preguntar al EZO
+static void ezoQuery(const char* cmd, bool refresh) {
+  Probe& pr = cur();
+  unsigned long ageMs = 0;
+  const char* resp = refresh ? nullptr : pr.cache.lookup(cmd, millis(), &ageMs);
+  if (!resp) {
+    ezoSubmit(cmd);
+    return;
+  }
+  pr.cache.countHit();
+  if (batch.running) batch.ezoOk++;
+  if (!LOG_ENABLED(LOG_INFO)) return;
+  printTag(F("EZO"), selProbe);
+  Serial.print(F("Respuesta: "));
+  Serial.print(resp);
+  Serial.print(F(" (caché, "));
+  Serial.print(ageMs / 1000UL);
+  Serial.println(F(" s)"));
+}
+
+static bool isRefresh(const char* arg) { return cliIs(arg, PSTR("?!")); }
+
+// Ve todas las respuestas del EZO: mantiene la caché de consultas y la salud
+static void onEzoDone(EzoLink& link, EzoStatus status, const char* cmd, const char* resp, uint8_t len, void*) {
+  Probe& pr = probeOf(link);
+  pr.cache.note(cmd, status, resp, len, millis());
+  pr.health.noteReply(status, len);
+}
+
+// Imprime un valor de lectura; en punto fijo no usa Serial.print(float)
+static void printValue(ec_value_t v, uint8_t decimals) {
+#if EC_FIXED_POINT
+  char buf[13];
+  formatMilli(buf, v, decimals);
+  Serial.print(buf);
+#else
+  Serial.print(v, decimals);
+#endif
+}
+
+// Imprime milésimas (las magnitudes de ec_derived.h) con 0..3 decimales
+static void printMilli(int32_t milli, uint8_t decimals) {
+  char buf[13];
+  formatMilli(buf, milli, decimals);
+  Serial.print(buf);
+}
+
+#if EC_FIXED_POINT
+static const uint8_t EC_PRINT_DECIMALS = 3;  // resolución del punto fijo
+#else
+static const uint8_t EC_PRINT_DECIMALS = 6;
+#endif
+
+// Tablas de nombres en PROGMEM (en el Uno no ocupan SRAM)
+static inline const __FlashStringHelper* flashStr(const char* p) {
+  return reinterpret_cast<const __FlashStringHelper*>(p);
+}
+
+// Índice del nombre (sin distinguir mayúsculas) en una tabla PROGMEM, o -1
+template <uint8_t N, uint8_t W>
+static int8_t flashIndex(const char (&table)[N][W], const char* arg) {
+  for (uint8_t i = 0; i < N; i++) if (strcasecmp_P(arg, table[i]) == 0) return (int8_t)i;
+  return -1;
+}
+
+// Nombres de las salidas del EZO, en el orden de los bits EC_FIELD_*
+static const char OUTPUT_NAMES[4][4] PROGMEM = { "EC", "TDS", "SAL", "SG" };
+
+// "O,<salida>,0|1" en q (10 bytes)
+static void outputCommand(char* q, uint8_t idx, bool on) {
+  strcpy_P(q, PSTR("O,"));
+  strcat_P(q, OUTPUT_NAMES[idx]);
+  strcat_P(q, on ? PSTR(",1") : PSTR(",0"));
+}
+
+// Lo ponen los comandos que cambian algo de Settings; cliStep() y el final
+// de un batch solo guardan entonces (en flash emulada cada guardado
+// reescribe el sector)
+static bool settingsDirty = false;
+static void settingsChanged() { settingsDirty = true; }
+
+static void saveSettings() {
+  settingsDirty = false;
+  Settings st;
+  memset(&st, 0, sizeof(st));
+  for (uint8_t i = 0; i < PROBE_COUNT; i++) {
+    if (probes[i].streamingEnabled) st.streamMask |= (uint8_t)(1 << i);
+    st.ezoOutputMask[i] = probes[i].outputMask;
+  }
+  st.readPeriodMs = readPeriodMs;
+  st.printRaw = printRaw;
+  st.outFormat = outFormat;
+  st.sampleFields = sampleFields;
+  st.logLevel = logLevel;
+  st.tempAuto = tempAuto;
+  st.tempDeadbandCenti = tempDeadbandCenti;
+  st.filterMode = filterMode;
+  st.filterLen = filterLen;
+  st.decimation = decimation;
+  st.deltaMilli = deltaMilli;
+  st.heartbeatS = heartbeatS;
+  st.dutyPeriodS = dutyPeriodS;
+  st.dutyReadings = dutyReadings;
+#if NET_SINK
+  st.netBatch = netBatcher.batch();
+  st.netFormat = netBatcher.format();
+  st.netFlushMs = netBatcher.flushMs();
+#endif
+  settingsSave(st);
+}
+
+static bool loadSettings() {
+  Settings st;
+  if (!settingsLoad(st)) return false;
+  for (uint8_t i = 0; i < PROBE_COUNT; i++) {
+    probes[i].streamingEnabled = (st.streamMask >> i) & 1;
+    probes[i].outputMask = st.ezoOutputMask[i] & 0x0F;
+  }
+  if (st.readPeriodMs != 0) readPeriodMs = st.readPeriodMs;
+  printRaw = st.printRaw != 0;
+  sampleFields = (uint8_t)((st.sampleFields | EC_FIELD_EC | EC_FIELD_SG) & Features::fields);
+  if (st.outFormat <= OUT_CSV && Features::format(st.outFormat)) outFormat = (OutFormat)st.outFormat;
+  logLevel = (st.logLevel <= LOG_LEVEL_MAX) ? st.logLevel : LOG_LEVEL_MAX;
+  tempAuto = TEMP_SENSOR && st.tempAuto;
+  tempDeadbandCenti = st.tempDeadbandCenti;
+  if (st.filterMode <= EC_FILTER_EWMA) filterMode = (EcFilterMode)st.filterMode;
+  filterLen = st.filterLen;
+  decimation = st.decimation;
+  for (Probe& pr : probes) pr.filter.configure(filterMode, filterLen, decimation);
+  deltaMilli = (st.deltaMilli > 0) ? st.deltaMilli : 0;
+  if (st.heartbeatS != 0) heartbeatS = st.heartbeatS;
+  dutyPeriodS = st.dutyPeriodS;
+  dutyReadings = st.dutyReadings ? st.dutyReadings : 1;
+#if NET_SINK
+  if (st.netBatch != 0 && st.netFlushMs != 0 && st.netFormat <= SINK_JSON) {
+    netBatcher.configure(st.netBatch, st.netFlushMs, (SinkFormat)st.netFormat);
+  }
+#endif
+  return true;
+}
+
+static void printOutputMask(uint8_t mask) {
+  for (uint8_t i = 0; i < 4; i++) {
+    Serial.print(' ');
+    Serial.print(flashStr(OUTPUT_NAMES[i]));
+    Serial.print((mask & (1 << i)) ? F(" ON") : F(" OFF"));
+  }
+  Serial.println();
+}
+
+// Interpreta "?O,EC,TDS,S,SG" (S = salinidad) como máscara EC_FIELD_*
+static uint8_t parseOutputMask(const char* resp) {
+  uint8_t mask = 0;
+  const char* p = resp + 3;  // tras "?O,"
+  while (*p) {
+    const char* e = p;
+    while (*e && *e != ',') e++;
+    const uint8_t n = (uint8_t)(e - p);
+    if (n == 2 && strncmp(p, "EC", 2) == 0) mask |= EC_FIELD_EC;
+    else if (n == 3 && strncmp(p, "TDS", 3) == 0) mask |= EC_FIELD_TDS;
+    else if ((n == 1 && p[0] == 'S') || (n == 3 && strncmp(p, "SAL", 3) == 0)) mask |= EC_FIELD_SAL;
+    else if (n == 2 && strncmp(p, "SG", 2) == 0) mask |= EC_FIELD_SG;
+    p = *e ? e + 1 : e;
+  }
+  return mask;
+}
+
+// ctx de O,? y de los O,<canal>,n: la generación de configuración que los
+// encoló. Tras un reinicio del EZO (healthStep) las que siguen en cola ya no
+// cuentan para la configuración nueva.
+static bool configStale(const Probe& pr, void* ctx) { return (uint8_t)(uintptr_t)ctx != pr.configGen; }
+
+static void onConfigDone(EzoLink& link, EzoStatus status, const char* cmd, const char* resp, uint8_t len, void* ctx) {
+  printExchange(link, status, cmd, resp, len);
+  Probe& pr = probeOf(link);
+  if (configStale(pr, ctx) || pr.configRemaining == 0) return;
+  if (--pr.configRemaining > 0) return;  // el último comando cierra la configuración
+  pr.outputsConfigured = true;
+  if (LOG_ENABLED(LOG_INFO)) {
+    printTag(F("Config"), link.id());
+    Serial.print(F("Salidas configuradas:"));
+    printOutputMask(pr.outputMask);
   }
-  return resp;
 }
 
-static void configureOutputsOnce() {
-  if (outputsConfigured) return;
+// Respuesta a O,?: solo se envían los O,<canal>,n que difieren de la
+// máscara guardada. Si no hay respuesta válida se envían todos.
+static void onOutputsQuery(EzoLink& link, EzoStatus status, const char* cmd, const char* resp, uint8_t len, void* ctx) {
+  printExchange(link, status, cmd, resp, len);
+  Probe& pr = probeOf(link);
+  if (configStale(pr, ctx)) return;
+  uint8_t diff = 0x0F;
+  if (status == EZO_OK && strncmp(resp, "?O,", 3) == 0) {
+    diff = parseOutputMask(resp) ^ pr.outputMask;
+  }
+  char q[10];
+  for (uint8_t i = 0; i < 4; i++) {
+    if (!(diff & (1 << i))) continue;
+    outputCommand(q, i, (pr.outputMask >> i) & 1);
+    if (link.submit(q, EZO_TIMEOUT_AUTO, onConfigDone, ctx)) pr.configRemaining++;
+  }
+  if (pr.configRemaining == 0) {
+    pr.outputsConfigured = true;
+    if (LOG_ENABLED(LOG_INFO)) {
+      printTag(F("Config"), link.id());
+      Serial.print(F("Salidas ya al día:"));
+      printOutputMask(pr.outputMask);
+    }
+  }
+}
+
+// Reacciona a la salud de la sonda: tras un reinicio del EZO vuelve a
+// aplicar la configuración guardada y avisa de caídas y recuperaciones
+static void healthStep(Probe& pr) {
+  if (pr.health.takeReconfigure()) {
+    pr.outputsConfigured = pr.outputsQueued = false;
+    pr.configRemaining = 0;
+    pr.configGen++;
+    pr.tempSentCenti = TEMP_NONE;   // el EZO arranca con T = 25 °C
+    pr.cache.clear();
+    if (LOG_ENABLED(LOG_INFO)) { printTag(F("EZO"), pr.link.id()); Serial.println(F("Reinicio detectado, reconfigurando")); }
+  }
+  const EzoHealthState st = pr.health.state();
+  if (st == pr.healthShown) return;
+  if (LOG_ENABLED(LOG_ERR) && (st == EZO_HEALTH_DOWN || pr.healthShown == EZO_HEALTH_DOWN)) {
+    printTag(F("EZO"), pr.link.id());
+    Serial.println(st == EZO_HEALTH_DOWN ? F("Sin respuesta; se reintenta con espera creciente")
+                                         : F("Sonda recuperada"));
+  }
+  pr.healthShown = st;
+}
+
+#if !EZO_TRANSPORT_I2C
+// Respuesta al C,0 del arranque; solo se muestra en LOG_DEBUG o si falla
+static void onQuietDone(EzoLink& link, EzoStatus status, const char* cmd, const char* resp, uint8_t len, void*) {
+  printExchange(link, status, cmd, resp, len, LOG_DEBUG);
+}
+#endif
+
+static void configureOutputsOnce(Probe& pr) {
+  if (pr.outputsConfigured || pr.outputsQueued) return;
 
   // Limpia cualquier basura en el buffer del EZO
-  while (ezoSerial.available()) (void)ezoSerial.read();
+  pr.link.flushInput();
+
+#if !EZO_TRANSPORT_I2C
+  // El EZO guarda C,n y no se sabe cómo quedó antes de reiniciar la placa:
+  // una lectura espontánea se tomaría como la respuesta de O,?. C,0 solo
+  // espera *OK, así que las lecturas que lleguen mientras tanto se descartan.
+  // Si el modo continuo lo activó la CLI, se respeta (onEzoLine las consume).
+  if (!pr.continuousMode) (void)pr.link.submit("C,0", EZO_TIMEOUT_AUTO, onQuietDone);
+#endif
 
   // Habilita etiquetas EC/TDS/SAL/SG
   // Configuración única del EZO: temperatura y salidas
   // ezoSend("T,25.0");   // compensación a 25 °C; ajusta si tu muestra difiere
   // ezoReadLine();       // lee '*OK'
-  
-  // ezoSend("O,EC,1");   // muestra EC
-  // ezoReadLine();
-  
-  // ezoSend("O,TDS,0");  // desactiva TDS (lo calculamos nosotros)
-  // ezoReadLine();
-  
-  // ezoSend("O,SAL,0");  // muestra SAL (si la necesitas)
-  // ezoReadLine();
-  
-  // ezoSend("O,SG,0");   // muestra SG
-  // ezoReadLine();
-  ezoQuery("O,EC,1", 1200);
-  ezoQuery("O,TDS,0", 1200);
-  ezoQuery("O,SAL,0", 1200);
-  ezoQuery("O,SG,0", 1200);
-
-  // estado de error 
-  // ezoSend("O,?");
-  // Serial.print("Salida O,? -> "); Serial.println(ezoReadLine());
-
-  outputsConfigured = true;
-  Serial.println("[Config] Salidas configuradas: EC ON, TDS/SAL/SG OFF.");
-}
-
-// helper para parsear líneas del EZO con o sin etiquetas (EC,TDS,SAL,SG)
-bool parseEcLine(const String &line, float &ec, float &tds, float &sal, float &sg) {
-    String s = line; s.trim();
-    if (s.length() == 0) return false;
-    if (s.startsWith("*OK")) return false; // confirmación de configuración, no es lectura
-
-    // Formato con etiquetas: "EC,<v>,TDS,<v>,SAL,<v>,SG,<v>"
-    if (s.indexOf("EC") != -1 || s.indexOf("TDS") != -1 || s.indexOf("SAL") != -1 || s.indexOf("SG") != -1) {
-        float lec=0, ltds=0, lsal=0, lsg=0; int found=0; int pos=0; bool ecFound=false;
-        while (pos < s.length()) {
-            int c = s.indexOf(',', pos);
-            String tok = (c == -1) ? s.substring(pos) : s.substring(pos, c); tok.trim();
-            pos = (c == -1) ? s.length() : c + 1;
-            if (tok == "EC" || tok == "TDS" || tok == "SAL" || tok == "SG") {
-                int c2 = s.indexOf(',', pos);
-                String val = (c2 == -1) ? s.substring(pos) : s.substring(pos, c2); val.trim();
-                float f = val.toFloat();
-                if (tok == "EC") { lec = f; ecFound = true; }
-                else if (tok == "TDS") ltds = f;
-                else if (tok == "SAL") lsal = f;
-                else lsg = f;
-                found++;
-                pos = (c2 == -1) ? s.length() : c2 + 1;
-            }
-        }
-        if (ecFound) { ec=lec; tds=ltds; sal=lsal; sg=lsg; return true; }
-        return false;
+
+  // Una sola consulta O,?; los O,<canal>,n se encolan en onOutputsQuery()
+  // solo para las salidas que no coinciden con la máscara de la EEPROM
+  pr.outputsQueued = pr.link.submit("O,?", EZO_TIMEOUT_AUTO, onOutputsQuery, (void*)(uintptr_t)pr.configGen);
+}
+
+// Respuesta a "o <canal> on|off": ctx lleva el bit del canal y el valor en el bit 7
+static void onOutputSet(EzoLink& link, EzoStatus status, const char* cmd, const char* resp, uint8_t len, void* ctx) {
+  printExchange(link, status, cmd, resp, len);
+  batchNote(status, cmd, resp, len);
+  if (status != EZO_OK || strncmp(resp, "*OK", 3) != 0) return;
+  const uint8_t v = (uint8_t)(uintptr_t)ctx;
+  const uint8_t bit = v & 0x0F;
+  Probe& pr = probeOf(link);
+  if (v & 0x80) pr.outputMask |= bit;
+  else pr.outputMask &= (uint8_t)~bit;
+  saveSettings();
+}
+
+// Muestra una lectura interpretada en el formato activo. tMs es el instante
+// de la muestra (envío del R) y rttMs lo que tardó la respuesta (0 si no se sabe).
+static void emitSample(uint8_t probe, const EcReading& rd, uint8_t fields, unsigned long tMs, uint16_t rttMs) {
+  const ec_value_t ec = rd.ec;
+  const uint16_t seq = sampleSeq++;
+  sampleRing.push(seq, tMs, ecToMilli(ec), probe);
+
+  if (outIs(OUT_BIN)) {
+    uint8_t frame[EC_FRAME_LEN];
+    ecFrameEncode(frame, seq, tMs, ecToMilli(ec), rttMs, ecFrameFlags(fields, probe));
+    Serial.write(frame, EC_FRAME_LEN);
+    return;
+  }
+  if (!Features::format(OUT_TEXT) && !Features::format(OUT_CSV)) return;
+
+  // EC debe estar en µS/cm; si está en mS/cm multiplícalo por 1000 antes.
+  // Las derivadas se calculan aquí (ec_derived.h), sin pedírselas al EZO.
+  const int32_t ecMilli = ecToMilli(ec);
+  const ec_value_t tds_calc = showField(EC_FIELD_TDS) ? ecMulFrac(ec, Features::tdsNum, Features::tdsDen) : 0;  // ppm
+  const int32_t salMilli = showField(EC_FIELD_SAL) ? ecSalinityMilli(ecMilli) : 0;        // PSU
+  const int32_t resMilli = showField(SAMPLE_FIELD_RES) ? ecResistivityMilli(ecMilli) : 0;  // MΩ·cm
+
+  if (outIs(OUT_CSV)) {
+    // probe,seq,ms,rtt,ec[,tds][,sal][,sg][,res]: las columnas compiladas
+    // siempre están; vacías si están desactivadas o el EZO no envía SG
+    Serial.print(probe);                     Serial.print(',');
+    Serial.print(seq);                       Serial.print(',');
+    Serial.print(tMs);                       Serial.print(',');
+    Serial.print(rttMs);                     Serial.print(',');
+    printValue(ec, EC_PRINT_DECIMALS);
+    if (Features::field(EC_FIELD_TDS)) { Serial.print(','); if (showField(EC_FIELD_TDS)) printValue(tds_calc, 1); }
+    if (Features::field(EC_FIELD_SAL)) { Serial.print(','); if (showField(EC_FIELD_SAL)) printMilli(salMilli, 3); }
+    if (Features::field(EC_FIELD_SG)) {
+      Serial.print(',');
+      if (fields & EC_FIELD_SG) printValue(rd.sg, EC_PRINT_DECIMALS);
+    }
+    if (Features::field(SAMPLE_FIELD_RES)) {
+      Serial.print(',');
+      if (showField(SAMPLE_FIELD_RES) && resMilli != EC_RES_OPEN) printMilli(resMilli, 2);
+    }
+    Serial.println();
+    return;
+  }
+  if (!Features::format(OUT_TEXT)) return;
+
+  printTag(F("Lectura"), probe);
+  Serial.print(F("Interpretación #"));
+  Serial.print(seq);
+  Serial.print(F(" (t="));
+  Serial.print(tMs);
+  Serial.print(F(" ms, rtt="));
+  Serial.print(rttMs);
+  Serial.println(F(" ms):"));
+  Serial.print(F("  EC: "));   printValue(ec, EC_PRINT_DECIMALS); Serial.println(F(" µS/cm"));
+  if (showField(EC_FIELD_TDS)) {
+    Serial.print(F("  TDS≈: ")); printValue(tds_calc, 1); Serial.println(F(" ppm"));
+  }
+  if (showField(EC_FIELD_SAL)) {
+    Serial.print(F("  SAL: ")); printMilli(salMilli, 3); Serial.println(F(" PSU"));
+  }
+  if (showField(SAMPLE_FIELD_RES)) {
+    if (resMilli == EC_RES_OPEN) Serial.println(F("  RES: n/a (EC=0)"));
+    else { Serial.print(F("  RES: ")); printMilli(resMilli, 2); Serial.println(F(" MΩ·cm")); }
+  }
+  if (!Features::field(EC_FIELD_SG)) return;
+  if (fields & EC_FIELD_SG) {
+    Serial.print(F("  SG: ")); printValue(rd.sg, EC_PRINT_DECIMALS); Serial.println();
+  } else {
+    Serial.println(F("  SG: n/a"));
+  }
+}
+
+// Vuelca de una vez el buffer de muestras, de la más antigua a la más reciente
+static void dumpSamples(bool binary) {
+  const uint16_t n = sampleRing.size();
+  if (!binary) {
+    Serial.print(F("[Dump] ")); Serial.print(n); Serial.println(F(" muestras"));
+    Serial.println(F("probe,seq,ms,ec_uS_cm"));
+  }
+  for (uint16_t i = 0; i < n; i++) {
+    const Sample& smp = sampleRing.at(i);
+    if (binary) {
+      uint8_t frame[EC_FRAME_LEN];
+      ecFrameEncode(frame, sampleRing.seqAt(i), smp.ms, smp.ecMilli, 0, ecFrameFlags(EC_FIELD_EC, smp.probe()));
+      Serial.write(frame, EC_FRAME_LEN);
+    } else {
+      char buf[13];
+      formatMilli(buf, smp.ecMilli, 3);
+      Serial.print(smp.probe());         Serial.print(',');
+      Serial.print(sampleRing.seqAt(i)); Serial.print(',');
+      Serial.print(smp.ms);              Serial.print(',');
+      Serial.println(buf);
+    }
+  }
+}
+
+// stream delta: decide si la muestra se emite y actualiza la referencia
+static bool deltaDue(Probe& pr, int32_t ecMilli, unsigned long tMs) {
+  if (deltaMilli > 0 && pr.emitted) {
+    const int32_t d = ecMilli - pr.lastEmitMilli;
+    const bool moved = (d >= deltaMilli || d <= -deltaMilli);
+    if (!moved && tMs - pr.lastEmitMs < (unsigned long)heartbeatS * 1000UL) {
+      pr.suppressed++;
+      return false;
     }
+  }
+  pr.emitted = true;
+  pr.lastEmitMilli = ecMilli;
+  pr.lastEmitMs = tMs;
+  return true;
+}
 
-    // Formato sin etiquetas: "ec,tds,sal,sg"
-    int p1 = s.indexOf(',');
-    if (p1 == -1) { // solo EC
-        ec = s.toFloat();
-        tds = 0; sal = 0; sg = 0;
-        return true;
+// Parsea una línea de lectura y la emite; tMs es el instante de la muestra
+// (envío del R) y tReplyMs el de la respuesta. Devuelve la máscara de campos
+// (0 si no es lectura). En bin/csv solo se emiten muestras, para no mezclar
+// texto con los registros.
+static uint8_t reportReading(uint8_t probe, const char* line, uint8_t len, unsigned long tMs,
+                             unsigned long tReplyMs) {
+  const bool text = outIs(OUT_TEXT);
+  // En LOG_DEBUG la respuesta ya se mostró en el intercambio; no se repite
+  if (printRaw && text && !LOG_ENABLED(LOG_DEBUG)) {
+    printTag(F("EZO"), probe); Serial.print(F("Raw: ")); Serial.println(line);
+  }
+  // Ahora: parsea y muestra sólo si es lectura válida
+  EcReading rd;
+  uint8_t fields;
+  {
+    PerfScope t(PERF_PARSE);
+    fields = ezoParseLine(line, len, rd);
+  }
+  if (fields == 0 && len > 0 && line[0] != '*') perfCount(PERF_PARSE_FAIL);
+  if (fields != 0) {
+    // Con filtro, las lecturas intermedias solo se acumulan (decimación)
+    EcFilter& f = probes[probe].filter;
+    int32_t ecMilli;
+    if (f.active()) {
+      if (!f.push(ecToMilli(rd.ec), ecMilli)) return fields;
+      rd.ec = ecFromMilli(ecMilli);
     }
-    int p2 = s.indexOf(',', p1+1); if (p2 == -1) return false;
-    int p3 = s.indexOf(',', p2+1); if (p3 == -1) return false;
-    String a = s.substring(0, p1); String b = s.substring(p1+1, p2);
-    String c = s.substring(p2+1, p3); String d = s.substring(p3+1);
-    ec = a.toFloat(); tds = b.toFloat(); sal = c.toFloat(); sg = d.toFloat();
+    if (!deltaDue(probes[probe], ecToMilli(rd.ec), tMs)) return fields;
+    PerfScope t(PERF_PRINT);
+    const unsigned long rtt = tReplyMs - tMs;
+    emitSample(probe, rd, fields, tMs, rtt > 0xFFFF ? 0xFFFF : (uint16_t)rtt);
+  } else if (!text || !LOG_ENABLED(LOG_ERR)) {
+      // nada: el host solo espera registros
+  } else if (strncmp(line, "*OK", 3) == 0) {
+      // Serial.println("Lectura: *OK (comando de configuración aceptado)");
+  } else if (len == 0) {
+      printTag(F("Lectura"), probe); Serial.println(F("(timeout)"));
+  } else if (line[0] == '*') {
+      // *ER, *OV, *UV, *RS, *RE: los cuenta EzoHealth (comando "health")
+      printTag(F("Lectura"), probe); Serial.print(F("Código del EZO: "));
+      Serial.println(line);
+  } else {
+      printTag(F("Lectura"), probe); Serial.print(F("Respuesta no interpretable: "));
+      Serial.println(line);
+  }
+  return fields;
+}
+
+// Cierra una actualización de T (T,x o RT,x): si el EZO no dio error, x
+// pasa a ser la temperatura de referencia para la banda muerta
+static void tempUpdateDone(Probe& pr, EzoStatus status, const char* resp, uint8_t len) {
+  if (pr.tempInFlight == TEMP_NONE) return;
+  if (status == EZO_OK && len > 0 && strncmp(resp, "*ER", 3) != 0) pr.tempSentCenti = pr.tempInFlight;
+  pr.tempInFlight = TEMP_NONE;
+}
+
+// Respuesta de un R del streaming; el siguiente R ya está en la rejilla
+// de pr.grid, independiente de lo que tardó esta respuesta.
+static void onStreamRead(EzoLink& link, EzoStatus status, const char* cmd, const char* line, uint8_t len, void*) {
+  Probe& pr = probeOf(link);
+  pr.readInFlight = false;
+  if (status == EZO_TIMEOUT) perfCount(PERF_TIMEOUT);
+  else perfAdd(PERF_RTT, micros() - link.lastSentUs());
+  if (pr.tempInFlight != TEMP_NONE && status == EZO_OK && strncmp(line, "*ER", 3) == 0) {
+    pr.noRt = true;   // firmware sin RT: desde ahora R y T por separado
+    if (LOG_ENABLED(LOG_ERR)) { printTag(F("T"), link.id()); Serial.println(F("RT no soportado, se usa T,x")); }
+  }
+  tempUpdateDone(pr, status, line, len);
+  if (outIs(OUT_TEXT)) printExchange(link, status, cmd, line, len, LOG_DEBUG);
+  (void)reportReading(link.id(), line, len, link.lastSentMs(), millis());
+}
+
+// Observador de líneas del EZO: en modo continuo consume las lecturas no
+// solicitadas; las respuestas "*.." y "?.." siguen yendo al comando activo
+static bool onEzoLine(EzoLink& link, const char* line, uint8_t len, EzoLineEvent ev, void*) {
+  Probe& pr = probeOf(link);
+  pr.health.noteLine(line, len);   // *ER, *OV, *UV, *RS, *RE
+  if (!pr.continuousMode) return false;
+  if (len == 0 || line[0] == '*' || line[0] == '?') return false;
+
+  const unsigned long t = millis();
+  const unsigned long expectMs = (unsigned long)pr.continuousSec * 1000UL;
+#if !EZO_TRANSPORT_I2C
+  if (boardEzoSerialOverflow()) {   // se perdieron bytes en el buffer RX
+    pr.contDropped++;
+    perfCount(PERF_DROPPED);
+  }
+#endif
+  if (pr.contLastMs != 0 && t - pr.contLastMs > expectMs + expectMs / 2) {
+    const uint32_t lost = (t - pr.contLastMs + expectMs / 2) / expectMs - 1;
+    pr.contDropped += lost;
+    perfCount(PERF_DROPPED, lost);
+  }
+  pr.contLastMs = t;
+
+  if (ev == EZO_LINE_TRUNCATED) {
+    pr.contMerged++;
+    if (!outIs(OUT_TEXT) || !LOG_ENABLED(LOG_ERR)) return true;
+    printTag(F("Continuo"), link.id());
+    Serial.print(F("Línea truncada: "));
+    Serial.println(line);
     return true;
+  }
+  if (reportReading(link.id(), line, len, t, t) != 0) {
+    pr.contSamples++;
+  } else {
+    pr.contMerged++;  // dos lecturas sin '\r' entre ellas, o ruido en la línea
+  }
+  return true;
 }
 
-void setup() {
-  Serial.begin(115200);
-  ezoSerial.begin(9600);
-  delay(200);
+static void printContinuousStats(uint8_t probe) {
+  const Probe& pr = probes[probe];
+  printTag(F("Continuo"), probe);
+  Serial.print(pr.continuousMode ? F("ON cada ") : F("OFF, último C,"));
+  Serial.print(pr.continuousSec);
+  Serial.print(F(" s, muestras="));
+  Serial.print(pr.contSamples);
+  Serial.print(F(" perdidas="));
+  Serial.print(pr.contDropped);
+  Serial.print(F(" fundidas="));
+  Serial.println(pr.contMerged);
+}
 
-  configureOutputsOnce();  // solo una vez
+// Respuesta a C,n: ctx lleva n (0 = desactivar)
+static void onContinuousDone(EzoLink& link, EzoStatus status, const char* cmd, const char* resp, uint8_t len, void* ctx) {
+  printExchange(link, status, cmd, resp, len);
+  batchNote(status, cmd, resp, len);
+  if (status != EZO_OK || strncmp(resp, "*OK", 3) != 0) return;
+  Probe& pr = probeOf(link);
+  const uint8_t n = (uint8_t)(uintptr_t)ctx;
+  pr.continuousMode = (n != 0);
+  if (n != 0) {
+    pr.continuousSec = n;
+    pr.contLastMs = 0;
+    pr.contSamples = pr.contDropped = pr.contMerged = 0;
+  }
+  printContinuousStats(link.id());
+}
+
+// ---------------------------------------------------------------------------
+// CLI: manejadores de la tabla de comandos (ver cli.h). argv[0] es el nombre.
+
+// Devuelve 1/0 para on/off, o -1 si no es ninguno
+static int8_t parseOnOff(const char* arg) {
+  if (cliIs(arg, PSTR("on"))) return 1;
+  if (cliIs(arg, PSTR("off"))) return 0;
+  return -1;
+}
+
+// Valida un número y lo normaliza con los decimales indicados (sin float)
+static bool formatArg(const char* arg, uint8_t decimals, char* out, ec_value_t* value = nullptr) {
+  ec_value_t v;
+  if (!ezoParseValue(arg, (uint8_t)strlen(arg), v)) return false;
+  formatMilli(out, ecToMilli(v), decimals);
+  if (value) *value = v;
+  return true;
+}
+
+// Encola "<prefix><valor>" con el valor normalizado, o informa el error
+static void submitWithValue(const char* prefix, const char* arg, uint8_t decimals,
+                            const __FlashStringHelper* usage) {
+  char q[EzoLink::CMD_MAX];
+  const uint8_t n = (uint8_t)strlen(prefix);
+  if (n + 13 > (uint8_t)sizeof(q) || !formatArg(arg, decimals, q + n)) {
+    Serial.println(usage);
+    return;
+  }
+  memcpy(q, prefix, n);
+  ezoSubmit(q);
+}
+
+static void printHelp() {
   Serial.println(F("[Ayuda] Comandos disponibles (terminar con Enter):"));
   Serial.println(F("  help                 → muestra esta ayuda"));
   Serial.println(F("  r                    → lectura inmediata (EZO R)"));
   Serial.println(F("  t <C>                → compensación de temperatura, ej: t 25.0"));
   Serial.println(F("  t ?                  → consulta compensación de temperatura actual"));
+  Serial.println(F("  t auto on|off        → compensación con el sensor local (DS18B20)"));
+  Serial.println(F("  t db <C>             → banda muerta para reenviar T, ej: t db 0.2"));
   Serial.println(F("  cal clear            → borra calibración"));
   Serial.println(F("  cal dry              → calibración en seco (EC sensor)"));
   Serial.println(F("  cal low <µS/cm>      → punto bajo, ej: cal low 84.0"));
   Serial.println(F("  cal mid <µS/cm>      → punto medio, ej: cal mid 1413"));
   Serial.println(F("  cal high <µS/cm>     → punto alto, ej: cal high 12880"));
   Serial.println(F("  cal <µS/cm>          → atajo: usa punto medio (mid)"));
+  Serial.println(F("  cal auto dry|low|mid|high <µS/cm> → espera lectura estable, calibra y verifica"));
+  Serial.println(F("  cal abort            → cancela la calibración guiada"));
   Serial.println(F("  k <0.1|1.0|10.0>    → fija constante de celda de la sonda"));
   Serial.println(F("  k ?                  → consulta constante de celda actual"));
   Serial.println(F("  cal ?                → consulta estado de calibración"));
@@ -159,195 +848,1069 @@ void setup() {
   Serial.println(F("  o tds on|off         → salida etiquetada TDS"));
   Serial.println(F("  o sal on|off         → salida etiquetada SAL"));
   Serial.println(F("  o sg on|off          → salida etiquetada SG"));
+  Serial.println(F("  derive tds|sal|res on|off → TDS≈, salinidad PSS-78 y resistividad calculadas aquí"));
+  Serial.println(F("  derive ?             → magnitudes derivadas activas"));
   Serial.println(F("  stream on|off        → habilita/deshabilita lecturas periódicas"));
+  Serial.println(F("  stream delta <µS/cm> [s] → solo emite si EC cambia (o cada s, por defecto 60)"));
   Serial.println(F("  period <ms>          → fija periodo de lectura (por defecto 1000)"));
   Serial.println(F("  raw on|off           → muestra también la respuesta cruda del EZO"));
+  Serial.print(F("  fmt text|bin|csv     → formato de las muestras (bin: registro de "));
+  Serial.print(EC_FRAME_LEN);
+  Serial.println(F(" bytes con CRC-8)"));
+  Serial.println(F("  log off|err|info|debug → nivel de mensajes de diagnóstico"));
+  Serial.println(F("  dump [csv|bin|clear] → vuelca (o borra) el buffer de últimas muestras"));
   Serial.println(F("  o ?                  → consulta estado de salidas"));
   Serial.println(F("  i                    → información del dispositivo"));
   Serial.println(F("  status               → estado del dispositivo"));
+  Serial.println(F("  (k/o/cal/i/status: se contestan desde caché; con ?! se pregunta al EZO)"));
   Serial.println(F("  led on|off           → LED del módulo"));
   Serial.println(F("  factory              → restaurar fábrica (borra calib.)"));
   Serial.println(F("  sleep                → bajo consumo (despierta con reset)"));
-  Serial.println(F("  c on|off             → modo continuo del EZO (no recomendado con stream)"));
+  Serial.println(F("  duty <s> <n>|off|?   → ciclo de bajo consumo: n lecturas cada s segundos"));
+#if NET_SINK
+  Serial.println(F("  net batch <n>|flush <ms>|fmt bin|json → envío por lotes a la red; net ? → estado"));
+#endif
+  Serial.println(F("  c on|off|<n>         → modo continuo del EZO (C,n: una lectura cada n s)"));
+  Serial.println(F("  c ?                  → estado del modo continuo (muestras, perdidas)"));
+  Serial.println(F("  filter mean|median|ewma <n> → filtro de EC (off para quitarlo)"));
+  Serial.println(F("  avg <n>              → una muestra filtrada por cada n lecturas"));
+  Serial.println(F("  perf [reset|bin]     → tiempos de loop/RTT/parseo/impresión y contadores"));
+  Serial.println(F("  bench <s>|off        → informe de perf cada s segundos (binario con fmt bin)"));
+  Serial.println(F("  lat                  → latencia medida y plazo adaptativo por tipo de comando"));
+  Serial.println(F("  health [reset]       → estado de la sonda y contadores de error (*ER/*OV/*UV/reinicios)"));
+  Serial.println(F("  batch begin|end|abort → graba comandos y los ejecuta en tubería"));
+  Serial.println(F("  <cmd>; <cmd>; ...    → batch en una sola línea"));
+  if (PROBE_COUNT > 1) {
+    Serial.println(F("  p <n>                → selecciona la sonda para los comandos siguientes"));
+    Serial.println(F("  p ?                  → sonda seleccionada"));
+  }
 }
 
-void loop() {
-  // Si aún hay comandos de configuración en curso, evita reenviarlos
-  if (!outputsConfigured) {
-    configureOutputsOnce();
-  }
-
-  // Procesa líneas desde la terminal serial USB
-  if (Serial.available()) {
-    static String cli;
-    static unsigned long cliLastByteMs = 0;
-    bool terminated = false;
-    while (Serial.available()) {
-      char c = (char)Serial.read();
-      if (c == '\n' || c == '\r') { // acepta LF o CR como fin de línea
-        terminated = true;
-        break;
-      }
-      cli += c;
-      cliLastByteMs = millis();
+static void cmdHelp(uint8_t, char**) { printHelp(); }
+
+static void cmdRead(uint8_t, char**) { ezoSubmit("R"); }
+
+static void printTempStatus() {
+  char buf[13];
+  Serial.print(F("[T] Sensor: "));
+#if TEMP_SENSOR
+  if (tempSensor.centi() != TEMP_NONE) {
+    formatMilli(buf, (int32_t)tempSensor.centi() * 10, 2);
+    Serial.print(buf);
+    Serial.print(F(" C"));
+  } else {
+    Serial.print(F("sin lectura"));
+  }
+  Serial.print(F(" (errores ")); Serial.print(tempSensor.errors()); Serial.print(')');
+#else
+  Serial.print(F("no compilado"));
+#endif
+  Serial.print(F(", auto ")); Serial.print(tempAuto ? F("ON") : F("OFF"));
+  formatMilli(buf, (int32_t)tempDeadbandCenti * 10, 2);
+  Serial.print(F(", banda ")); Serial.print(buf);
+  const int16_t sent = cur().tempSentCenti;
+  if (sent != TEMP_NONE) {
+    formatMilli(buf, (int32_t)sent * 10, 2);
+    Serial.print(F(", enviada ")); Serial.print(buf);
+  }
+  Serial.println();
+}
+
+static void cmdTemp(uint8_t argc, char** argv) {
+  if (cliIs(argv[1], PSTR("?"))) {
+    printTempStatus();
+    ezoSubmit("T,?");
+  } else if (cliIs(argv[1], PSTR("auto"))) {
+    const int8_t en = (argc > 2) ? parseOnOff(argv[2]) : -1;
+    if (en < 0) { Serial.println(F("[T] Usa: t auto on|off")); return; }
+    if (en && !TEMP_SENSOR) {
+      Serial.println(F("[T] Sin sensor local (compilar con -DTEMP_DS18B20_PIN=<pin>)"));
+      return;
     }
-    // procesa si hubo terminador o si no llegan más bytes en ~300 ms (para "Line ending: None")
-    bool idleTimeout = (cli.length() > 0) && (millis() - cliLastByteMs > 300);
-    if (cli.length() > 0 && (terminated || idleTimeout)) {
-      String cmd = cli; cmd.trim(); cli = "";
-      int sp1 = cmd.indexOf(' ');
-      String a = (sp1 == -1) ? cmd : cmd.substring(0, sp1);
-      String rest = (sp1 == -1) ? "" : cmd.substring(sp1+1);
-      a.toLowerCase(); rest.trim();
-
-      if (a == "help") {
-        Serial.println(F("[Ayuda] Comandos: help, r, t <C>, cal clear|dry|low|mid|high <v>, cal ?, o <canal> on|off"));
-      } else if (a == "r") {
-        (void)ezoQuery("R", 1000);
-      } else if (a == "t") {
-        if (rest == "?" || rest == "?") {
-          (void)ezoQuery("T,?", 1200);
-        } else {
-          float tc = rest.toFloat();
-          char buf[24]; dtostrf(tc, 0, 2, buf);
-          String q = String("T,") + String(buf);
-          (void)ezoQuery(q.c_str(), 1200);
-        }
-      } else if (a == "cal") {
-        String b; String val; int sp2 = rest.indexOf(' ');
-        b = (sp2 == -1) ? rest : rest.substring(0, sp2);
-        val = (sp2 == -1) ? "" : rest.substring(sp2+1);
-        b.toLowerCase(); val.trim();
-
-        if (b == "clear") {
-          (void)ezoQuery("Cal,clear", 1500);
-        } else if (b == "dry") {
-          (void)ezoQuery("Cal,dry", 2000);
-        } else if (b == "?") {
-          (void)ezoQuery("Cal,?", 1500);
-        } else if (b == "low" || b == "mid" || b == "high") {
-          float f = val.toFloat();
-          if (val.length() == 0) {
-            Serial.println(F("[Cal] Falta valor en µS/cm, ej: cal low 84.0"));
-          } else {
-            char buf[24]; dtostrf(f, 0, 2, buf);
-            String q = String("Cal,") + b + String(",") + String(buf);
-            (void)ezoQuery(q.c_str(), 4000);
-          }
-        } else if (b.length() > 0 && (isDigit(b[0]) || b[0] == '-' || b[0] == '+')) {
-          // Atajo: "cal <valor>" → selecciona low/mid/high según magnitud (µS/cm)
-          float f = b.toFloat();
-          const float v = f;
-          const char* mode = (v <= 200.0f ? "low" : (v <= 3000.0f ? "mid" : "high"));
-          char buf[24]; dtostrf(v, 0, 2, buf);
-          String q = String("Cal,") + String(mode) + String(",") + String(buf);
-          (void)ezoQuery(q.c_str(), 4000);
-        } else {
-          Serial.println(F("[Cal] Subcomando desconocido. Usa: clear|dry|low|mid|high|? o 'cal <µS/cm>'"));
-        }
-      } else if (a == "o") {
-        String ch; String onoff; int sp2 = rest.indexOf(' ');
-        ch = (sp2 == -1) ? rest : rest.substring(0, sp2);
-        onoff = (sp2 == -1) ? "" : rest.substring(sp2+1);
-        ch.toLowerCase(); onoff.toLowerCase(); onoff.trim();
-        if (ch == "?") { (void)ezoQuery("O,?", 1500); }
-        else {
-          int en = (onoff == "on") ? 1 : (onoff == "off" ? 0 : -1);
-          if (en == -1) {
-            Serial.println(F("[O] Usa on|off. Ej: o ec on"));
-          } else if (ch == "ec" || ch == "tds" || ch == "sal" || ch == "sg") {
-            String q = String("O,") + ch + String(",") + String(en);
-            (void)ezoQuery(q.c_str(), 1500);
-          } else {
-            Serial.println(F("[O] Canal desconocido. Usa: ec|tds|sal|sg"));
-          }
-        }
-      } else if (a == "stream") {
-        rest.toLowerCase();
-        if (rest == "on") { streamingEnabled = true; Serial.println(F("[Stream] ON")); }
-        else if (rest == "off") { streamingEnabled = false; Serial.println(F("[Stream] OFF")); }
-        else Serial.println(F("[Stream] Usa: stream on|off"));
-      } else if (a == "period") {
-        unsigned long ms = (unsigned long)rest.toInt();
-        if (ms == 0) Serial.println(F("[Period] Debe ser > 0 ms"));
-        else { readPeriodMs = ms; Serial.print(F("[Period] ")); Serial.print(readPeriodMs); Serial.println(F(" ms")); }
-      } else if (a == "raw") {
-        rest.toLowerCase();
-        if (rest == "on") { printRaw = true; Serial.println(F("[Raw] ON")); }
-        else if (rest == "off") { printRaw = false; Serial.println(F("[Raw] OFF")); }
-        else Serial.println(F("[Raw] Usa: raw on|off"));
-      } else if (a == "i") {
-        (void)ezoQuery("I", 1500);
-      } else if (a == "status") {
-        (void)ezoQuery("Status", 1500);
-      } else if (a == "led") {
-        rest.toLowerCase();
-        if (rest == "on") (void)ezoQuery("L,1", 1200);
-        else if (rest == "off") (void)ezoQuery("L,0", 1200);
-        else Serial.println(F("[LED] Usa: led on|off"));
-      } else if (a == "factory") {
-        (void)ezoQuery("Factory", 2000);
-      } else if (a == "sleep") {
-        (void)ezoQuery("Sleep", 1200);
-      } else if (a == "c") {
-        rest.toLowerCase();
-        if (rest == "on") (void)ezoQuery("C,1", 1200);
-        else if (rest == "off") (void)ezoQuery("C,0", 1200);
-        else Serial.println(F("[C] Usa: c on|off"));
-      } else if (a == "k") {
-        if (rest == "?" || rest == "?") {
-          (void)ezoQuery("K,?", 1200);
-        } else {
-          // acepta 0.1, 1.0, 10.0
-          float kv = rest.toFloat();
-          if (kv == 0) { Serial.println(F("[K] Usa 0.1 | 1.0 | 10.0")); }
-          else {
-            char buf[16]; dtostrf(kv, 0, 1, buf);
-            String q = String("K,") + String(buf);
-            (void)ezoQuery(q.c_str(), 1500);
-          }
+    tempAuto = en;
+    settingsChanged();
+    for (Probe& pr : probes) pr.tempSentCenti = TEMP_NONE;  // reenvía al activar
+    printTempStatus();
+  } else if (cliIs(argv[1], PSTR("db"))) {
+    ec_value_t v;
+    const int32_t milli = (argc > 2 && ezoParseValue(argv[2], (uint8_t)strlen(argv[2]), v)) ? ecToMilli(v) : -1;
+    if (milli < 0 || milli > 10000) { Serial.println(F("[T] Usa: t db <0-10 C>, ej: t db 0.2")); return; }
+    tempDeadbandCenti = (uint16_t)(milli / 10);
+    settingsChanged();
+    printTempStatus();
+  } else if (argc > 2) {
+    Serial.println(F("[T] Usa: t <C>|?|auto on|off|db <C>"));
+  } else {
+    if (tempAuto) {
+      tempAuto = false;   // un valor manual no debe pisarse con el del sensor
+      settingsChanged();
+      Serial.println(F("[T] Compensación automática OFF"));
+    }
+    submitWithValue("T,", argv[1], 2, F("[T] Usa: t <C>|?, ej: t 25.0"));
+  }
+}
+
+static void printMilliField(const __FlashStringHelper* label, int32_t milli) {
+  char buf[13];
+  formatMilli(buf, milli, 1);
+  Serial.print(label);
+  Serial.print(buf);
+}
+
+// Verificación tras calibrar: la respuesta (?CAL,n) cierra la guía
+static void onCalVerify(EzoLink& link, EzoStatus status, const char* cmd, const char* resp, uint8_t len, void*) {
+  printExchange(link, status, cmd, resp, len);
+  calGuide.stage = CAL_IDLE;
+  printTag(F("Cal"), link.id());
+  if (status == EZO_OK && len > 0 && strncmp(resp, "?CAL,", 5) == 0) {
+    Serial.print(F("Calibración guiada completada en "));
+    Serial.print((millis() - calGuide.startMs) / 1000UL);
+    Serial.println(F(" s"));
+  } else {
+    Serial.println(F("Calibrada, pero Cal,? no respondió como se esperaba"));
+  }
+}
+
+static void onCalSet(EzoLink& link, EzoStatus status, const char* cmd, const char* resp, uint8_t len, void*) {
+  printExchange(link, status, cmd, resp, len);
+  if (status != EZO_OK || len == 0 || strncmp(resp, "*ER", 3) == 0) {
+    calGuide.stage = CAL_IDLE;
+    printTag(F("Cal"), link.id());
+    Serial.println(F("El EZO rechazó la calibración"));
+    return;
+  }
+  calGuide.stage = CAL_VERIFYING;
+  if (!link.submit("Cal,?", EZO_TIMEOUT_AUTO, onCalVerify)) calGuide.stage = CAL_IDLE;
+}
+
+// Lectura interna de la guía: alimenta el detector y calibra al estabilizar
+static void onCalRead(EzoLink& link, EzoStatus status, const char*, const char* line, uint8_t len, void*) {
+  calGuide.readInFlight = false;
+  if (calGuide.stage != CAL_SAMPLING) return;
+  EcReading rd;
+  if (status != EZO_OK || !(ezoParseLine(line, len, rd) & EC_FIELD_EC)) {
+    if (status == EZO_TIMEOUT) perfCount(PERF_TIMEOUT);
+    if (LOG_ENABLED(LOG_ERR)) { printTag(F("Cal"), link.id()); Serial.println(F("Lectura no válida, se ignora")); }
+    return;
+  }
+  EcStability& st = calGuide.stab;
+  const bool stable = st.push(ecToMilli(rd.ec));
+  if (LOG_ENABLED(LOG_INFO)) {
+    printTag(F("Cal"), link.id());
+    printMilliField(F("EC "), st.meanMilli());
+    printMilliField(F(", deriva "), st.driftMilli());
+    printMilliField(F(", desv "), st.sigmaMilli());
+    printMilliField(F(", tol "), st.toleranceMilli());
+    Serial.print(F(" ("));
+    Serial.print(st.count()); Serial.print('/'); Serial.print(st.length());
+    Serial.println(')');
+  }
+  if (!stable) return;
+  printTag(F("Cal"), link.id()); Serial.print(F("Estable, enviando ")); Serial.println(calGuide.cmd);
+  calGuide.stage = CAL_SETTING;
+  if (!link.submit(calGuide.cmd, EZO_TIMEOUT_AUTO, onCalSet)) calGuide.stage = CAL_IDLE;
+}
+
+// Pide la siguiente lectura de la guía en cuanto llega la anterior
+static void calGuideStep() {
+  if (calGuide.stage != CAL_SAMPLING || calGuide.readInFlight) return;
+  if (millis() - calGuide.startMs > CAL_GUIDE_TIMEOUT_MS) {
+    calGuide.stage = CAL_IDLE;
+    printTag(F("Cal"), calGuide.probe);
+    Serial.println(F("La lectura no se estabilizó; calibración cancelada"));
+    return;
+  }
+  if (probes[calGuide.probe].link.submit("R", EZO_TIMEOUT_AUTO, onCalRead)) calGuide.readInFlight = true;
+}
+
+// cal auto dry | cal auto low|mid|high <v>
+static void calGuideStart(uint8_t argc, char** argv) {
+  if (calGuide.stage != CAL_IDLE) { Serial.println(F("[Cal] Ya hay una calibración guiada; usa 'cal abort'")); return; }
+  if (duty.state != DUTY_OFF) { Serial.println(F("[Cal] Desactiva antes el ciclo de bajo consumo (duty off)")); return; }
+  const char* pt = (argc > 2) ? argv[2] : "";
+  if (cliIs(pt, PSTR("dry"))) {
+    strcpy(calGuide.cmd, "Cal,dry");
+  } else if (cliIs(pt, PSTR("low")) || cliIs(pt, PSTR("mid")) || cliIs(pt, PSTR("high"))) {
+    char val[13];
+    if (argc < 4 || !formatArg(argv[3], 2, val)) {
+      Serial.println(F("[Cal] Usa: cal auto low|mid|high <µS/cm>, ej: cal auto mid 1413"));
+      return;
+    }
+    snprintf(calGuide.cmd, sizeof(calGuide.cmd), "Cal,%s,%s", pt, val);
+  } else {
+    Serial.println(F("[Cal] Usa: cal auto dry|low|mid|high <µS/cm>"));
+    return;
+  }
+  calGuide.probe = selProbe;
+  calGuide.stab.configure(CAL_STABLE_N, CAL_STABLE_PERMILLE, CAL_STABLE_FLOOR_MILLI);
+  calGuide.startMs = millis();
+  calGuide.stage = CAL_SAMPLING;
+  printTag(F("Cal"), selProbe);
+  Serial.print(F("Esperando lectura estable para "));
+  Serial.println(calGuide.cmd);
+}
+
+static void cmdCal(uint8_t argc, char** argv) {
+  const char* b = argv[1];
+  if (cliIs(b, PSTR("auto"))) {
+    calGuideStart(argc, argv);
+  } else if (cliIs(b, PSTR("abort"))) {
+    // una Cal,... ya enviada sigue su curso; solo se dejan de pedir lecturas
+    if (calGuide.stage == CAL_SAMPLING) calGuide.stage = CAL_IDLE;
+    Serial.println(F("[Cal] Calibración guiada cancelada"));
+  } else if (cliIs(b, PSTR("clear"))) {
+    ezoSubmit("Cal,clear");
+  } else if (cliIs(b, PSTR("dry"))) {
+    ezoSubmit("Cal,dry");
+  } else if (cliIs(b, PSTR("?")) || isRefresh(b)) {
+    ezoQuery("Cal,?", isRefresh(b));
+  } else if (cliIs(b, PSTR("low")) || cliIs(b, PSTR("mid")) || cliIs(b, PSTR("high"))) {
+    if (argc < 3) {
+      Serial.println(F("[Cal] Falta valor en µS/cm, ej: cal low 84.0"));
+      return;
+    }
+    char prefix[10];
+    snprintf(prefix, sizeof(prefix), "Cal,%s,", b);
+    submitWithValue(prefix, argv[2], 2, F("[Cal] Valor no numérico, ej: cal low 84.0"));
+  } else if (isDigit(b[0]) || b[0] == '-' || b[0] == '+') {
+    // Atajo: "cal <valor>" → selecciona low/mid/high según magnitud (µS/cm)
+    ec_value_t v;
+    char val[13];
+    if (!formatArg(b, 2, val, &v)) {
+      Serial.println(F("[Cal] Valor no numérico, ej: cal 1413"));
+      return;
+    }
+    const char* mode = (v <= ecFromInt(200) ? "low" : (v <= ecFromInt(3000) ? "mid" : "high"));
+    char q[EzoLink::CMD_MAX];
+    snprintf(q, sizeof(q), "Cal,%s,%s", mode, val);
+    ezoSubmit(q);
+  } else {
+    Serial.println(F("[Cal] Subcomando desconocido. Usa: clear|dry|low|mid|high|? o 'cal <µS/cm>'"));
+  }
+}
+
+static void cmdOutput(uint8_t argc, char** argv) {
+  if (cliIs(argv[1], PSTR("?")) || isRefresh(argv[1])) { ezoQuery("O,?", isRefresh(argv[1])); return; }
+  const int8_t en = (argc > 2) ? parseOnOff(argv[2]) : -1;
+  if (en == -1) {
+    Serial.println(F("[O] Usa on|off. Ej: o ec on"));
+    return;
+  }
+  const int8_t idx = flashIndex(OUTPUT_NAMES, argv[1]);
+  if (idx < 0) {
+    Serial.println(F("[O] Canal desconocido. Usa: ec|tds|sal|sg"));
+    return;
+  }
+  char q[10];
+  outputCommand(q, (uint8_t)idx, en);
+  const uint8_t bit = (uint8_t)(1 << idx);
+  cliSubmit(q, EZO_TIMEOUT_AUTO, onOutputSet, (void*)(uintptr_t)(bit | (en ? 0x80 : 0)));
+}
+
+static void printStream() {
+  const Probe& pr = cur();
+  printTag(F("Stream"), selProbe);
+  Serial.print(pr.streamingEnabled ? F("ON") : F("OFF"));
+  Serial.print(F(", huecos saltados ")); Serial.print(pr.grid.skipped());
+  if (deltaMilli > 0) {
+    char buf[13];
+    formatMilli(buf, deltaMilli, EC_PRINT_DECIMALS);
+    Serial.print(F(", delta ")); Serial.print(buf);
+    Serial.print(F(" µS/cm, latido ")); Serial.print(heartbeatS);
+    Serial.print(F(" s, omitidas ")); Serial.print(pr.suppressed);
+  }
+  Serial.println();
+}
+
+static void cmdStream(uint8_t argc, char** argv) {
+  if (cliIs(argv[1], PSTR("?"))) { printStream(); return; }
+  if (cliIs(argv[1], PSTR("delta"))) {
+    // stream delta <µS/cm> [latido s]
+    ec_value_t v;
+    const int32_t thr = (argc > 2 && ezoParseValue(argv[2], (uint8_t)strlen(argv[2]), v)) ? ecToMilli(v) : 0;
+    const long hb = (argc > 3) ? (isDigit(argv[3][0]) ? atol(argv[3]) : 0) : heartbeatS;
+    if (thr <= 0 || hb < 1 || hb > 65535) {
+      Serial.println(F("[Stream] Usa: stream delta <µS/cm> [latido 1-65535 s]"));
+      return;
+    }
+    deltaMilli = thr;
+    heartbeatS = (uint16_t)hb;
+    for (Probe& pr : probes) { pr.emitted = false; pr.suppressed = 0; }
+    if (!cur().streamingEnabled) cur().grid.start(millis());
+    cur().streamingEnabled = true;
+    settingsChanged();
+    printStream();
+    return;
+  }
+  const int8_t en = (argc == 2) ? parseOnOff(argv[1]) : -1;
+  if (en < 0) { Serial.println(F("[Stream] Usa: stream on|off|?|delta <µS/cm> [s]")); return; }
+  if (en && !cur().streamingEnabled) cur().grid.start(millis());   // la rejilla arranca ahora
+  cur().streamingEnabled = en;
+  if (en) deltaMilli = 0;   // "stream on" vuelve a emitir todas las muestras
+  settingsChanged();
+  printStream();
+}
+
+static void cmdPeriod(uint8_t, char** argv) {
+  const unsigned long ms = strtoul(argv[1], nullptr, 10);
+  if (ms == 0) { Serial.println(F("[Period] Debe ser > 0 ms")); return; }
+  readPeriodMs = ms;
+  settingsChanged();
+  for (Probe& pr : probes) pr.grid.start(millis());
+  Serial.print(F("[Period] ")); Serial.print(readPeriodMs); Serial.println(F(" ms"));
+}
+
+static void cmdRaw(uint8_t, char** argv) {
+  const int8_t en = parseOnOff(argv[1]);
+  if (en < 0) { Serial.println(F("[Raw] Usa: raw on|off")); return; }
+  printRaw = en;
+  settingsChanged();
+  Serial.println(en ? F("[Raw] ON") : F("[Raw] OFF"));
+}
+
+static void cmdFmt(uint8_t, char** argv) {
+  OutFormat f;
+  if (cliIs(argv[1], PSTR("text"))) f = OUT_TEXT;
+  else if (cliIs(argv[1], PSTR("bin"))) f = OUT_BIN;
+  else if (cliIs(argv[1], PSTR("csv"))) f = OUT_CSV;
+  else { Serial.println(F("[Fmt] Usa: fmt text|bin|csv")); return; }
+  if (!Features::format(f)) { Serial.println(F("[Fmt] Formato no incluido en este binario (OUT_FORMATS)")); return; }
+  outFormat = f;
+  settingsChanged();
+  if (outIs(OUT_TEXT)) Serial.println(F("[Fmt] text"));
+  else if (outIs(OUT_BIN)) Serial.println(F("[Fmt] bin"));
+  else if (outIs(OUT_CSV)) {
+    Serial.println(F("[Fmt] csv"));
+    Serial.print(F("probe,seq,ms,rtt_ms,ec_uS_cm"));
+    if (Features::field(EC_FIELD_TDS)) Serial.print(F(",tds_ppm"));
+    if (Features::field(EC_FIELD_SAL)) Serial.print(F(",sal_psu"));
+    if (Features::field(EC_FIELD_SG)) Serial.print(F(",sg"));
+    if (Features::field(SAMPLE_FIELD_RES)) Serial.print(F(",res_Mohm_cm"));
+    Serial.println();
+  }
+}
+
+// Magnitudes derivadas que se activan con "derive", en bits de SAMPLE_FIELDS
+static const char DERIVED_NAMES[3][4] PROGMEM = { "tds", "sal", "res" };
+static const uint8_t DERIVED_BITS[] = { EC_FIELD_TDS, EC_FIELD_SAL, SAMPLE_FIELD_RES };
+
+static void printDerive() {
+  Serial.print(F("[Derive]"));
+  for (uint8_t i = 0; i < 3; i++) {
+    if (!Features::field(DERIVED_BITS[i])) continue;
+    Serial.print(' ');
+    Serial.print(flashStr(DERIVED_NAMES[i]));
+    Serial.print((sampleFields & DERIVED_BITS[i]) ? F(" ON") : F(" OFF"));
+  }
+  Serial.println();
+}
+
+static void cmdDerive(uint8_t argc, char** argv) {
+  if (cliIs(argv[1], PSTR("?"))) { printDerive(); return; }
+  const int8_t en = (argc > 2) ? parseOnOff(argv[2]) : -1;
+  const int8_t idx = flashIndex(DERIVED_NAMES, argv[1]);
+  if (idx < 0 || en < 0) {
+    Serial.println(F("[Derive] Usa: derive tds|sal|res on|off, derive ?"));
+    return;
+  }
+  const uint8_t bit = DERIVED_BITS[idx];
+  if (!Features::field(bit)) {
+    Serial.println(F("[Derive] No incluida en este binario (SAMPLE_FIELDS)"));
+    return;
+  }
+  if (en) sampleFields |= bit;
+  else sampleFields &= (uint8_t)~bit;
+  settingsChanged();
+  printDerive();
+}
+
+static void cmdLog(uint8_t argc, char** argv) {
+  static const char names[4][6] PROGMEM = { "off", "err", "info", "debug" };
+  const int8_t lvl = (argc > 1) ? flashIndex(names, argv[1]) : -1;
+  if (lvl > LOG_LEVEL_MAX) {
+    Serial.print(F("[Log] Máximo compilado: ")); Serial.println(flashStr(names[LOG_LEVEL_MAX]));
+  } else if (lvl >= 0) {
+    logLevel = (uint8_t)lvl;
+    settingsChanged();
+    Serial.print(F("[Log] ")); Serial.println(flashStr(names[logLevel]));
+  } else if (argc == 1 || cliIs(argv[1], PSTR("?"))) {
+    Serial.print(F("[Log] ")); Serial.println(flashStr(names[logLevel]));
+  } else {
+    Serial.println(F("[Log] Usa: log off|err|info|debug"));
+  }
+}
+
+static void cmdDump(uint8_t argc, char** argv) {
+  if (argc == 1 || cliIs(argv[1], PSTR("csv"))) dumpSamples(false);
+  else if (cliIs(argv[1], PSTR("bin"))) dumpSamples(true);
+  else if (cliIs(argv[1], PSTR("clear"))) { sampleRing.clear(); Serial.println(F("[Dump] Buffer vacío")); }
+  else Serial.println(F("[Dump] Usa: dump [csv|bin|clear]"));
+}
+
+static void cmdInfo(uint8_t argc, char** argv) { ezoQuery("I", argc > 1 && isRefresh(argv[1])); }
+static void cmdStatus(uint8_t argc, char** argv) { ezoQuery("Status", argc > 1 && isRefresh(argv[1])); }
+static void cmdFactory(uint8_t, char**) { ezoSubmit("Factory"); }
+static void cmdSleep(uint8_t, char**) { ezoSubmit("Sleep"); }
+
+static void printDuty() {
+  Serial.print(F("[Duty] "));
+  if (duty.state == DUTY_OFF) { Serial.println(F("OFF")); return; }
+  Serial.print(dutyReadings); Serial.print(F(" lecturas cada "));
+  Serial.print(dutyPeriodS); Serial.print(F(" s, ciclos "));
+  Serial.println(duty.cycles);
+}
+
+static void dutyStart() {
+  duty.state = DUTY_READ;   // el EZO está despierto: el primer ciclo empieza ya
+  duty.cycleMs = duty.stateMs = millis();
+  duty.taken = 0;
+  duty.cycles = 0;
+}
+
+static void cmdDuty(uint8_t argc, char** argv) {
+  if (cliIs(argv[1], PSTR("?"))) { printDuty(); return; }
+  if (cliIs(argv[1], PSTR("off"))) {
+    // el EZO puede haber quedado dormido al final del último ciclo
+    if (duty.state != DUTY_OFF) for (EzoTransport& port : ezoPorts) port.wake();
+    duty.state = DUTY_OFF;
+    dutyPeriodS = 0;
+    settingsChanged();
+    printDuty();
+    return;
+  }
+  const long s = atol(argv[1]);
+  const long n = (argc > 2) ? atol(argv[2]) : 1;
+  if (s < 1 || s > 65535 || n < 1 || n > 255) {
+    Serial.println(F("[Duty] Usa: duty <1-65535 s> <1-255 lecturas>|off|?"));
+    return;
+  }
+  if (calGuide.stage != CAL_IDLE) { Serial.println(F("[Duty] Hay una calibración guiada en curso")); return; }
+  dutyPeriodS = (uint16_t)s;
+  dutyReadings = (uint8_t)n;
+  settingsChanged();
+  dutyStart();
+  printDuty();
+}
+
+#if NET_SINK
+static void printNet() {
+  Serial.print(F("[Net] "));
+  Serial.print(NET_SINK == NET_SINK_MQTT ? F("MQTT") : F("UDP"));
+  Serial.print(netConnected() ? F(" conectado") : F(" sin conexión"));
+  Serial.print(F(", lote ")); Serial.print(netBatcher.batch());
+  Serial.print(F(", flush ")); Serial.print(netBatcher.flushMs());
+  Serial.print(netBatcher.format() == SINK_JSON ? F(" ms, json") : F(" ms, bin"));
+  Serial.print(F(", paquetes ")); Serial.print(netBatcher.packets());
+  Serial.print(F(", muestras ")); Serial.print(netBatcher.sent());
+  Serial.print(F(", fallos ")); Serial.print(netBatcher.failures());
+  Serial.print(F(", perdidas ")); Serial.println(netBatcher.dropped());
+}
+
+static void cmdNet(uint8_t argc, char** argv) {
+  uint8_t batch = netBatcher.batch();
+  uint32_t flushMs = netBatcher.flushMs();
+  SinkFormat fmt = netBatcher.format();
+  if (cliIs(argv[1], PSTR("?"))) {
+    printNet();
+    return;
+  } else if (argc == 3 && cliIs(argv[1], PSTR("batch"))) {
+    const long n = atol(argv[2]);
+    if (n < 1 || n > 255) { Serial.println(F("[Net] Lote de 1 a 255 muestras")); return; }
+    batch = (uint8_t)n;
+  } else if (argc == 3 && cliIs(argv[1], PSTR("flush"))) {
+    flushMs = strtoul(argv[2], nullptr, 10);
+    if (flushMs == 0) { Serial.println(F("[Net] Debe ser > 0 ms")); return; }
+  } else if (argc == 3 && cliIs(argv[1], PSTR("fmt")) && (cliIs(argv[2], PSTR("bin")) || cliIs(argv[2], PSTR("json")))) {
+    fmt = cliIs(argv[2], PSTR("json")) ? SINK_JSON : SINK_BIN;
+  } else {
+    Serial.println(F("[Net] Usa: net ?|batch <n>|flush <ms>|fmt bin|json"));
+    return;
+  }
+  netBatcher.configure(batch, flushMs, fmt);
+  settingsChanged();
+  printNet();
+}
+#endif
+
+static void cmdLed(uint8_t, char** argv) {
+  const int8_t en = parseOnOff(argv[1]);
+  if (en == 1) ezoSubmit("L,1");
+  else if (en == 0) ezoSubmit("L,0");
+  else Serial.println(F("[LED] Usa: led on|off"));
+}
+
+static void cmdContinuous(uint8_t, char** argv) {
+  const char* arg = argv[1];
+  if (cliIs(arg, PSTR("?"))) {
+    printContinuousStats(selProbe);
+    return;
+  }
+  const int8_t onoff = parseOnOff(arg);
+  const long n = (onoff >= 0) ? onoff : (isDigit(arg[0]) ? atol(arg) : -1);
+  if (n < 0 || n > 99) {
+    Serial.println(F("[C] Usa: c on|off|<1-99 s>|?"));
+    return;
+  }
+  char q[8];
+  snprintf(q, sizeof(q), "C,%d", (int)n);
+  cliSubmit(q, EZO_TIMEOUT_AUTO, onContinuousDone, (void*)(uintptr_t)n);
+}
+
+static void cmdK(uint8_t, char** argv) {
+  // acepta 0.1, 1.0, 10.0
+  if (cliIs(argv[1], PSTR("?")) || isRefresh(argv[1])) ezoQuery("K,?", isRefresh(argv[1]));
+  else submitWithValue("K,", argv[1], 1, F("[K] Usa 0.1 | 1.0 | 10.0"));
+}
+
+// Latencia medida por clase de comando y plazo que se aplicará al siguiente
+static void cmdLatency(uint8_t, char**) {
+  const EzoLink& link = cur().link;
+  for (uint8_t c = 0; c < EZO_CMD_CLASS_COUNT; c++) {
+    const EzoCmdClass cls = (EzoCmdClass)c;
+    const EzoLatency& lat = link.latency(cls);
+    printTag(F("Lat"), selProbe);
+    Serial.print(flashStr(ezoClassName(cls)));
+    Serial.print(F(": "));
+    if (lat.samples() > 0) {
+      Serial.print(lat.meanMs()); Serial.print(F(" ± ")); Serial.print(lat.devMs());
+      Serial.print(F(" ms, "));
+    }
+    Serial.print(F("plazo ")); Serial.print(lat.timeoutMs(ezoWorstCaseMs(cls)));
+    Serial.print(F(" ms (n=")); Serial.print(lat.samples());
+    Serial.print(F(", timeouts ")); Serial.print(lat.timeouts());
+    Serial.println(')');
+  }
+  printTag(F("Lat"), selProbe);
+  Serial.print(F("Consultas contestadas desde caché: "));
+  Serial.println(cur().cache.hits());
+}
+
+static void cmdHealth(uint8_t argc, char** argv) {
+  EzoHealth& h = cur().health;
+  if (argc > 1) {
+    if (!cliIs(argv[1], PSTR("reset"))) { Serial.println(F("[Health] Usa: health [reset]")); return; }
+    h.clearCounters();
+  }
+  printTag(F("Health"), selProbe);
+  Serial.print(h.state() == EZO_HEALTH_OK ? F("OK") : (h.state() == EZO_HEALTH_DOWN ? F("CAÍDA") : F("DEGRADADA")));
+  if (h.state() == EZO_HEALTH_DOWN) { Serial.print(F(" (espera ")); Serial.print(h.backoffMs()); Serial.print(F(" ms)")); }
+  Serial.print(F(", timeouts ")); Serial.print(h.timeouts());
+  Serial.print(F(", *ER ")); Serial.print(h.errors());
+  Serial.print(F(", *OV ")); Serial.print(h.overVolt());
+  Serial.print(F(", *UV ")); Serial.print(h.underVolt());
+  Serial.print(F(", reinicios ")); Serial.print(h.resets());
+  Serial.print(F(", caídas ")); Serial.println(h.downs());
+}
+
+static void cmdPerf(uint8_t argc, char** argv) {
+  if (argc == 1) {
+    perfPrint(Serial);
+  } else if (cliIs(argv[1], PSTR("reset"))) {
+    perfReset();
+    Serial.println(F("[Perf] Reiniciado"));
+  } else if (cliIs(argv[1], PSTR("bin"))) {
+    uint8_t frame[PERF_FRAME_LEN];
+    const uint8_t n = perfFrame(frame);
+    if (n) Serial.write(frame, n);
+    else perfPrint(Serial);
+  } else {
+    Serial.println(F("[Perf] Usa: perf [reset|bin]"));
+  }
+}
+
+// "bench <s>": emite el informe de perf cada s segundos (registro binario
+// con fmt bin) para tools/bench.py. No se guarda en EEPROM.
+static uint16_t benchPeriodS = 0;
+static unsigned long benchLastMs = 0;
+
+static void benchEmit() {
+  if (outIs(OUT_BIN)) {
+    uint8_t frame[PERF_FRAME_LEN];
+    if (perfFrame(frame)) { Serial.write(frame, PERF_FRAME_LEN); return; }
+  }
+  perfPrint(Serial);
+}
+
+static void cmdBench(uint8_t, char** argv) {
+  if (cliIs(argv[1], PSTR("?"))) {
+    Serial.print(F("[Bench] "));
+    if (benchPeriodS) { Serial.print(F("cada ")); Serial.print(benchPeriodS); Serial.println(F(" s")); }
+    else Serial.println(F("OFF"));
+    return;
+  }
+  const long s = cliIs(argv[1], PSTR("off")) ? 0 : (isDigit(argv[1][0]) ? atol(argv[1]) : -1);
+  if (s < 0 || s > 3600) { Serial.println(F("[Bench] Usa: bench <1-3600 s>|off|?")); return; }
+  benchPeriodS = (uint16_t)s;
+  benchLastMs = millis();
+  if (!outIs(OUT_BIN)) { Serial.print(F("[Bench] ")); Serial.println(s ? F("ON") : F("OFF")); }
+}
+
+static void benchStep() {
+  if (benchPeriodS == 0 || millis() - benchLastMs < benchPeriodS * 1000UL) return;
+  benchLastMs = millis();
+  benchEmit();
+}
+
+static void printFilter() {
+  static const char names[4][7] PROGMEM = { "off", "mean", "median", "ewma" };
+  Serial.print(F("[Filtro] ")); Serial.print(flashStr(names[filterMode]));
+  if (filterMode != EC_FILTER_OFF) { Serial.print(F(" n=")); Serial.print(filterLen); }
+  Serial.print(F(", 1 de cada ")); Serial.println(decimation);
+}
+
+static void applyFilter() {
+  for (Probe& pr : probes) pr.filter.configure(filterMode, filterLen, decimation);
+  filterLen = probes[0].filter.length();   // ya acotado por EcFilter
+  printFilter();
+}
+
+static void cmdFilter(uint8_t argc, char** argv) {
+  EcFilterMode mode;
+  if (cliIs(argv[1], PSTR("?"))) { printFilter(); return; }
+  if (cliIs(argv[1], PSTR("off"))) mode = EC_FILTER_OFF;
+  else if (cliIs(argv[1], PSTR("mean"))) mode = EC_FILTER_MEAN;
+  else if (cliIs(argv[1], PSTR("median"))) mode = EC_FILTER_MEDIAN;
+  else if (cliIs(argv[1], PSTR("ewma"))) mode = EC_FILTER_EWMA;
+  else { Serial.println(F("[Filtro] Usa: filter off|mean|median|ewma <n>|?")); return; }
+  const long n = (argc > 2 && isDigit(argv[2][0])) ? atol(argv[2]) : (mode == EC_FILTER_OFF ? 1 : -1);
+  if (n < 1 || n > 255) { Serial.println(F("[Filtro] Falta n (1..16; ewma 1..255)")); return; }
+  filterMode = mode;
+  filterLen = (uint8_t)n;
+  settingsChanged();
+  applyFilter();
+}
+
+// "avg n": una muestra filtrada por cada n lecturas; sin filtro usa media de n
+static void cmdAvg(uint8_t, char** argv) {
+  const long n = isDigit(argv[1][0]) ? atol(argv[1]) : -1;
+  if (n < 1 || n > 255) { Serial.println(F("[Avg] Usa: avg <1-255>")); return; }
+  decimation = (uint8_t)n;
+  if (filterMode == EC_FILTER_OFF && n > 1) {
+    filterMode = EC_FILTER_MEAN;
+    filterLen = (uint8_t)n;
+  }
+  settingsChanged();
+  applyFilter();
+}
+
+static void cmdProbe(uint8_t argc, char** argv) {
+  if (argc > 1 && !cliIs(argv[1], PSTR("?"))) {
+    const long n = isDigit(argv[1][0]) ? atol(argv[1]) : -1;
+    if (n >= 0 && n < PROBE_COUNT) selProbe = (uint8_t)n;
+    else { Serial.print(F("[P] Sondas: 0..")); Serial.println(PROBE_COUNT - 1); }
+  }
+  Serial.print(F("[P] Sonda ")); Serial.print(selProbe);
+#if EZO_TRANSPORT_I2C
+  Serial.print(F(" (I2C ")); Serial.print(PROBE_ADDRS[selProbe]); Serial.print(')');
+#endif
+  Serial.println();
+}
+
+static void batchStart() {
+  if (batch.overflow || batchScript.count() == 0) {
+    Serial.println(batch.overflow ? F("[Batch] Guion demasiado largo, descartado") : F("[Batch] Vacío"));
+    batch.overflow = false;
+    batchScript.clear();
+    return;
+  }
+  batch.running = true;
+  batch.failed = false;
+  batch.lines = batch.inFlight = batch.ezoOk = 0;
+  batch.startMs = millis();
+  Serial.print(F("[Batch] Ejecutando "));
+  Serial.print(batchScript.count());
+  Serial.println(F(" líneas"));
+}
+
+static void cmdBatch(uint8_t, char** argv) {
+  if (cliIs(argv[1], PSTR("begin"))) {
+    if (batch.running) { Serial.println(F("[Batch] Ya hay uno en ejecución")); return; }
+    batchScript.clear();
+    batch.recording = true;
+    batch.overflow = false;
+    Serial.println(F("[Batch] Grabando; termina con 'batch end'"));
+  } else if (cliIs(argv[1], PSTR("end"))) {
+    if (!batch.recording) { Serial.println(F("[Batch] No hay ninguno abierto")); return; }
+    batch.recording = false;
+    batchStart();
+  } else if (cliIs(argv[1], PSTR("abort"))) {
+    batch.recording = false;
+    if (batch.running) batchFail("abort");   // los ya encolados terminan igual
+    else { batchScript.clear(); Serial.println(F("[Batch] Descartado")); }
+  } else {
+    Serial.println(F("[Batch] Usa: batch begin|end|abort"));
+  }
+}
+
+// Nombres y usos en flash: la tabla entera vive en PROGMEM
+#define CLI_STR(id, text) static const char id[] PROGMEM = text;
+CLI_STR(N_HELP, "help")     CLI_STR(U_HELP, "help")
+CLI_STR(N_R, "r")           CLI_STR(U_R, "r")
+CLI_STR(N_T, "t")           CLI_STR(U_T, "t <C>|?|auto on|off|db <C>")
+CLI_STR(N_CAL, "cal")       CLI_STR(U_CAL, "cal clear|dry|?|low|mid|high <v>|<v>|auto <punto> [<v>]|abort")
+CLI_STR(N_K, "k")           CLI_STR(U_K, "k <0.1|1.0|10.0>|?")
+CLI_STR(N_O, "o")           CLI_STR(U_O, "o ec|tds|sal|sg on|off, o ?")
+CLI_STR(N_DERIVE, "derive") CLI_STR(U_DERIVE, "derive tds|sal|res on|off|?")
+CLI_STR(N_STREAM, "stream") CLI_STR(U_STREAM, "stream on|off|?|delta <µS/cm> [s]")
+CLI_STR(N_PERIOD, "period") CLI_STR(U_PERIOD, "period <ms>")
+CLI_STR(N_RAW, "raw")       CLI_STR(U_RAW, "raw on|off")
+CLI_STR(N_FMT, "fmt")       CLI_STR(U_FMT, "fmt text|bin|csv")
+CLI_STR(N_LOG, "log")       CLI_STR(U_LOG, "log [off|err|info|debug]")
+CLI_STR(N_DUMP, "dump")     CLI_STR(U_DUMP, "dump [csv|bin|clear]")
+CLI_STR(N_I, "i")           CLI_STR(U_I, "i [?!]")
+CLI_STR(N_STATUS, "status") CLI_STR(U_STATUS, "status [?!]")
+CLI_STR(N_LED, "led")       CLI_STR(U_LED, "led on|off")
+CLI_STR(N_FACTORY, "factory") CLI_STR(U_FACTORY, "factory")
+CLI_STR(N_SLEEP, "sleep")   CLI_STR(U_SLEEP, "sleep")
+CLI_STR(N_C, "c")           CLI_STR(U_C, "c on|off|<n>|?")
+CLI_STR(N_P, "p")           CLI_STR(U_P, "p [<n>|?]")
+CLI_STR(N_FILTER, "filter") CLI_STR(U_FILTER, "filter off|mean|median|ewma <n>|?")
+CLI_STR(N_AVG, "avg")       CLI_STR(U_AVG, "avg <n>")
+CLI_STR(N_PERF, "perf")     CLI_STR(U_PERF, "perf [reset|bin]")
+CLI_STR(N_BENCH, "bench")   CLI_STR(U_BENCH, "bench <s>|off|?")
+CLI_STR(N_LAT, "lat")       CLI_STR(U_LAT, "lat")
+CLI_STR(N_HEALTH, "health") CLI_STR(U_HEALTH, "health [reset]")
+CLI_STR(N_BATCH, "batch")   CLI_STR(U_BATCH, "batch begin|end|abort")
+CLI_STR(N_DUTY, "duty")     CLI_STR(U_DUTY, "duty <s> <n>|off|?")
+#if NET_SINK
+CLI_STR(N_NET, "net")       CLI_STR(U_NET, "net ?|batch <n>|flush <ms>|fmt bin|json")
+#endif
+#undef CLI_STR
+
+static const CliCommand COMMANDS[] PROGMEM = {
+  { N_HELP,    U_HELP,    0, 0, cmdHelp },
+  { N_R,       U_R,       0, 0, cmdRead },
+  { N_T,       U_T,       1, 2, cmdTemp },
+  { N_CAL,     U_CAL,     1, 3, cmdCal },
+  { N_K,       U_K,       1, 1, cmdK },
+  { N_O,       U_O,       1, 2, cmdOutput },
+  { N_DERIVE,  U_DERIVE,  1, 2, cmdDerive },
+  { N_STREAM,  U_STREAM,  1, 3, cmdStream },
+  { N_PERIOD,  U_PERIOD,  1, 1, cmdPeriod },
+  { N_RAW,     U_RAW,     1, 1, cmdRaw },
+  { N_FMT,     U_FMT,     1, 1, cmdFmt },
+  { N_LOG,     U_LOG,     0, 1, cmdLog },
+  { N_DUMP,    U_DUMP,    0, 1, cmdDump },
+  { N_I,       U_I,       0, 1, cmdInfo },
+  { N_STATUS,  U_STATUS,  0, 1, cmdStatus },
+  { N_LED,     U_LED,     1, 1, cmdLed },
+  { N_FACTORY, U_FACTORY, 0, 0, cmdFactory },
+  { N_SLEEP,   U_SLEEP,   0, 0, cmdSleep },
+  { N_C,       U_C,       1, 1, cmdContinuous },
+  { N_P,       U_P,       0, 1, cmdProbe },
+  { N_FILTER,  U_FILTER,  1, 2, cmdFilter },
+  { N_AVG,     U_AVG,     1, 1, cmdAvg },
+  { N_PERF,    U_PERF,    0, 1, cmdPerf },
+  { N_BENCH,   U_BENCH,   1, 1, cmdBench },
+  { N_LAT,     U_LAT,     0, 0, cmdLatency },
+  { N_HEALTH,  U_HEALTH,  0, 1, cmdHealth },
+  { N_BATCH,   U_BATCH,   1, 1, cmdBatch },
+  { N_DUTY,    U_DUTY,    1, 2, cmdDuty },
+#if NET_SINK
+  { N_NET,     U_NET,     1, 2, cmdNet },
+#endif
+};
+static const uint8_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+// "batch ..." se despacha siempre, también mientras se graba o se ejecuta
+static bool isBatchCommand(const char* line) {
+  while (*line == ' ' || *line == '\t') line++;
+  return strncasecmp_P(line, PSTR("batch"), 5) == 0 && (line[5] == ' ' || line[5] == '\0');
+}
+
+static bool linksIdle() {
+  for (const Probe& pr : probes) if (pr.link.busy()) return false;
+  return true;
+}
+
+#if TEMP_SENSOR
+// Tras una lectura del modo continuo el EZO calla hasta la siguiente (C,n
+// con n >= 1 s): el 1-Wire solo se usa en ese hueco
+static const uint16_t CONT_QUIET_WINDOW_MS = 250;
+
+// Nada en vuelo y ninguna sonda a punto de emitir por su cuenta
+static bool ezoQuiet() {
+  if (!linksIdle()) return false;
+  const unsigned long now = millis();
+  for (const Probe& pr : probes) {
+    if (!pr.continuousMode) continue;
+    if (pr.contLastMs == 0 || now - pr.contLastMs >= CONT_QUIET_WINDOW_MS) return false;
+  }
+  return true;
+}
+#endif
+
+// Avanza el batch: despacha la siguiente línea cuando el EZO ya respondió a
+// todo lo que encoló la anterior, o da el estado final
+static void batchStep() {
+  if (!batch.running || batch.inFlight > 0) return;
+  // la primera línea espera a que no quede nada previo en vuelo, para no
+  // contar respuestas ajenas al batch
+  if (batch.lines == 0 && !linksIdle()) return;
+  char* line = batch.failed ? nullptr : batchScript.next();
+  if (line) {
+    batch.lines++;
+    const CliResult r = cliDispatch(COMMANDS, COMMAND_COUNT, line, Serial);
+    if (r == CLI_UNKNOWN || r == CLI_USAGE) batchFail(line);  // line es ya argv[0]
+    return;
+  }
+  batch.running = false;
+  if (settingsDirty) saveSettings();
+  if (batch.failed) {
+    Serial.print(F("[Batch] ERROR en '"));
+    Serial.print(batch.failedCmd);
+    Serial.print(F("': "));
+  } else {
+    Serial.print(F("[Batch] OK: "));
+  }
+  Serial.print(batch.lines);
+  Serial.print('/');
+  Serial.print(batchScript.count());
+  Serial.print(F(" líneas, "));
+  Serial.print(batch.ezoOk);
+  Serial.print(F(" respuestas EZO, "));
+  Serial.print(millis() - batch.startMs);
+  Serial.println(F(" ms"));
+  batchScript.clear();
+}
+
+// Temperatura a enviar a la sonda, o TEMP_NONE si no hace falta: sin
+// compensación automática, sin lectura, con otra en vuelo o dentro de la banda
+static int16_t tempTarget(const Probe& pr) {
+#if TEMP_SENSOR
+  const int16_t t = tempSensor.centi();
+  if (!tempAuto || t == TEMP_NONE || pr.tempInFlight != TEMP_NONE) return TEMP_NONE;
+  if (pr.tempSentCenti != TEMP_NONE && abs(t - pr.tempSentCenti) <= (int16_t)tempDeadbandCenti) return TEMP_NONE;
+  return t;
+#else
+  (void)pr;
+  return TEMP_NONE;
+#endif
+}
+
+// Respuesta a un T,x automático: solo se muestra en LOG_DEBUG
+static void onTempSet(EzoLink& link, EzoStatus status, const char* cmd, const char* resp, uint8_t len, void*) {
+  printExchange(link, status, cmd, resp, len, LOG_DEBUG);
+  tempUpdateDone(probeOf(link), status, resp, len);
+}
+
+// Tiempo que se deja al EZO tras despertarlo antes de pedirle lecturas
+static const unsigned long DUTY_WAKE_MS = 200;
+
+// Avanza el ciclo de bajo consumo. Devuelve true si el micro durmió (el
+// tiempo de loop medido no es representativo).
+static bool dutyStep() {
+  const unsigned long now = millis();
+  switch (duty.state) {
+    case DUTY_OFF:
+      return false;
+    case DUTY_WAKE:
+      if (now - duty.stateMs < DUTY_WAKE_MS) return false;
+      for (Probe& pr : probes) pr.link.flushInput();   // descarta el "*WA" del despertar
+      duty.state = DUTY_READ;
+      duty.taken = 0;
+      return false;
+    case DUTY_READ:
+      for (const Probe& pr : probes) if (pr.readInFlight) return false;
+      if (duty.taken < dutyReadings) {
+        // lecturas seguidas: la siguiente sale al llegar la anterior
+        for (Probe& pr : probes) {
+          if (pr.link.submit("R", EZO_TIMEOUT_AUTO, onStreamRead)) pr.readInFlight = true;
         }
-      } else {
-        Serial.print(F("[CLI] Comando desconocido: ")); Serial.println(cmd);
+        duty.taken++;
+        return false;
+      }
+      for (Probe& pr : probes) (void)pr.link.submit("Sleep", EZO_TIMEOUT_AUTO);
+      duty.state = DUTY_SLEEP;
+      return false;
+    case DUTY_SLEEP: {
+      // no se duerme con comandos pendientes, una línea a medio llegar o un batch
+      if (!linksIdle() || Serial.available() || batch.running) return false;
+      const unsigned long nextMs = duty.cycleMs + (unsigned long)dutyPeriodS * 1000UL;
+      const long left = (long)(nextMs - now);
+      if (left > 0) {
+        // sin power-down (ESP32/RP2040) se espera sin bloquear: la CLI sigue viva
+        if (!POWER_DOWN_AVAILABLE) return false;
+        Serial.flush();
+        powerDown((uint32_t)left);
       }
+      duty.cycleMs = (left > 0) ? nextMs : now;   // now: el ciclo activo duró más que el periodo
+      for (EzoTransport& port : ezoPorts) port.wake();
+      duty.cycles++;
+      duty.stateMs = millis();
+      duty.state = DUTY_WAKE;
+      return left > 0;
     }
   }
+  return false;
+}
+
+// Margen antes de contar un R como plazo perdido (iteraciones de loop normales)
+static const unsigned long PERF_DEADLINE_SLACK_MS = 20;
+
+// Inicio de la iteración anterior de acquireStep(), para PERF_LOOP
+static unsigned long loopUs = 0;
 
-  // Lecturas periódicas
+// Adquisición: avanza los EZO, el sensor de temperatura y las lecturas
+// periódicas. En el Uno se llama desde loop(); en placas con tareas
+// (board.h) corre aparte de la CLI.
+static void acquireStep() {
+  const unsigned long us = micros();
+  if (loopUs != 0) perfAdd(PERF_LOOP, us - loopUs);
+  loopUs = us;
+
+  for (Probe& pr : probes) {
+    healthStep(pr);
+
+    // Si aún hay comandos de configuración en curso, evita reenviarlos
+    if (!pr.outputsConfigured) {
+      configureOutputsOnce(pr);
+    }
+
+    // Avanza las transacciones pendientes con el EZO (no bloquea)
+    pr.link.poll();
+  }
+
+#if TEMP_SENSOR
+  // El bus 1-Wire solo se usa cuando no se espera nada del EZO, tampoco una
+  // lectura del modo continuo (ver temp_sensor.h)
+  (void)tempSensor.poll(millis(), EZO_TRANSPORT_I2C || ezoQuiet());
+#endif
+
+  // Lecturas periódicas: se envía R y se vuelve al loop; la respuesta se
+  // procesa en onStreamRead() cuando llegue (lectura en tubería). Cada sonda
+  // tiene su propio R en vuelo, así las conversiones se solapan.
+  // Los envíos siguen una rejilla fija (ezo_grid.h) sin deriva.
   unsigned long now = millis();
-  if (streamingEnabled && (now - lastReadMs >= readPeriodMs)) {
-    lastReadMs = now;
-
-    // Pedir lectura y mostrar claramente comando y respuesta
-    String line = ezoQuery("R", 900);  // EZO suele responder en < 1s
-    if (printRaw) { Serial.print(F("[EZO] Raw: ")); Serial.println(line); }
-    // Ahora: parsea y muestra sólo si es lectura válida
-    float ec = 0, tds = 0, sal = 0, sg = 0;
-    if (parseEcLine(line, ec, tds, sal, sg)) {
-        // EC debe estar en µS/cm; si está en mS/cm multiplícalo por 1000 antes
-        const float tds_calc = ec * TDS_PPM_FACTOR;     // ppm
-        const float sal_ppm  = ec * SAL_PPM_FACTOR;     // ppm (≈ TDS)
-        // const float sal_ppt  = sal_ppm / 1000.0f;    // ppt, por si quieres también
-
-        Serial.println(F("[Lectura] Interpretación:"));
-        Serial.print(F("  EC: "));   Serial.print(ec, 6);       Serial.println(F(" µS/cm"));
-        Serial.print(F("  TDS≈: ")); Serial.print(tds_calc, 1); Serial.println(F(" ppm"));
-        Serial.print(F("  SAL≈: ")); Serial.print(sal_ppm, 1);  Serial.println(F(" ppm"));
-        if (line.indexOf("SG") != -1) {
-          Serial.print(F("  SG: ")); Serial.println(sg, 6);
-        } else {
-          Serial.println(F("  SG: n/a"));
-        }
-    } else if (line.startsWith("*OK")) {
-        // Serial.println("Lectura: *OK (comando de configuración aceptado)");
-    } else if (line.length() == 0) {
-        Serial.println(F("[Lectura] (timeout)"));
-    } else {
-        Serial.print(F("[Lectura] Respuesta no interpretable: "));
-        Serial.println(line);
+  for (Probe& pr : probes) {
+    // con el ciclo de bajo consumo las lecturas las pide dutyStep() y el EZO
+    // solo acepta comandos en la fase de lectura (un T,x lo despertaría)
+    if (duty.state != DUTY_OFF && duty.state != DUTY_READ) continue;
+    const int16_t t = tempTarget(pr);
+    // En modo continuo el EZO ya emite las lecturas solo; no se pide R
+    const bool reading = pr.streamingEnabled && !pr.continuousMode && duty.state == DUTY_OFF &&
+                         !(calGuide.stage != CAL_IDLE && calGuide.probe == pr.link.id());
+    // Si hay que actualizar T va en la propia lectura (RT,x), sin ida y vuelta extra
+    const bool combine = reading && !pr.noRt;
+    if (reading && !pr.readInFlight && pr.grid.due(now) && !pr.health.allow(now)) {
+      // sonda caída (ezo_health.h): los huecos se saltan hasta el próximo sondeo
+      (void)pr.grid.advance(now, readPeriodMs);
+    } else if (reading && !pr.readInFlight && pr.grid.due(now)) {
+      char q[12] = "R";
+      if (combine && t != TEMP_NONE) {
+        memcpy(q, "RT,", 3);
+        formatMilli(q + 3, (int32_t)t * 10, 2);
+      }
+      if (pr.link.submit(q, EZO_TIMEOUT_AUTO, onStreamRead)) {
+        // el R sale tarde si la respuesta anterior llegó después de su hueco
+        if (pr.grid.lateMs(now) > PERF_DEADLINE_SLACK_MS) perfCount(PERF_MISSED_DEADLINE);
+        (void)pr.grid.advance(now, readPeriodMs);
+        pr.readInFlight = true;
+        if (q[1] == 'T') pr.tempInFlight = t;
+      }
+    } else if (!combine && t != TEMP_NONE && pr.health.state() != EZO_HEALTH_DOWN) {
+      char q[12] = "T,";
+      formatMilli(q + 2, (int32_t)t * 10, 2);
+      if (pr.link.submit(q, EZO_TIMEOUT_AUTO, onTempSet)) pr.tempInFlight = t;
     }
   }
+  calGuideStep();
+  if (dutyStep()) loopUs = 0;
 }
 
+// Procesa líneas desde la terminal serial USB
+static void cliStep() {
+  static CliLineBuffer cli;
+  if (char* line = cli.poll(Serial, millis())) {
+    if (cli.overflowed()) {
+      Serial.print(F("[CLI] Línea demasiado larga (máx. "));
+      Serial.print(CLI_LINE_MAX);
+      Serial.println(F(" caracteres)"));
+    } else if (isBatchCommand(line)) {
+      cliDispatch(COMMANDS, COMMAND_COUNT, line, Serial);
+    } else if (batch.running) {
+      Serial.println(F("[Batch] En ejecución; espera o usa 'batch abort'"));
+    } else if (batch.recording || strchr(line, ';')) {
+      if (!batchScript.append(line)) {
+        batch.overflow = true;
+        Serial.print(F("[Batch] Sin espacio (máx. "));
+        Serial.print(CLI_BATCH_MAX);
+        Serial.println(F(" bytes)"));
+      }
+      if (!batch.recording) batchStart();
+    } else if (cliDispatch(COMMANDS, COMMAND_COUNT, line, Serial) == CLI_OK && settingsDirty) {
+      saveSettings();  // solo si el comando cambió algo de Settings
+    }
+  }
+  batchStep();
+  benchStep();
+}
 
+static void acquireTask() {
+  BoardLock lock;
+  acquireStep();
+}
 
+#if NET_SINK
+// Envía a la red el siguiente lote del buffer de muestras. Solo se arma el
+// paquete con el cerrojo; el envío, que puede tardar, va fuera.
+static void netStep() {
+  static uint8_t packet[NET_PACKET_MAX];
+  if (!netSink().ready()) return;
+  uint16_t len = 0;
+  uint8_t n;
+  {
+    BoardLock lock;
+    n = netBatcher.build(sampleRing, millis(), packet, sizeof(packet), len);
+  }
+  if (n == 0) return;
+  const bool ok = netSink().publish(packet, len);
+  BoardLock lock;
+  netBatcher.commit(n, ok, millis());
+}
+#endif
+
+static bool acquireOwnTask = false;   // la adquisición corre en su tarea (board.h)
+
+void setup() {
+  boardRamPaint();   // antes de que la pila crezca: base de "RAM libre mín."
+  Serial.begin(115200);
+#if !EZO_TRANSPORT_I2C
+  boardEzoSerialBegin(9600);
+#endif
+  for (uint8_t i = 0; i < PROBE_COUNT; i++) {
+#if EZO_TRANSPORT_I2C
+    ezoPorts[i].setAddress(PROBE_ADDRS[i]);
+#endif
+    ezoPorts[i].begin();
+    probes[i].link.begin(ezoPorts[i], i);
+    probes[i].link.setMonitor(onEzoLine);
+    probes[i].link.setObserver(onEzoDone);
+  }
+  boardEepromBegin();
+  if (loadSettings() && LOG_ENABLED(LOG_INFO)) Serial.println(F("[Config] Ajustes restaurados de EEPROM"));
+  if (dutyPeriodS != 0) dutyStart();
+  delay(200);
+
+  for (Probe& pr : probes) {
+    configureOutputsOnce(pr);  // solo una vez (se completa en loop())
+    pr.grid.start(millis());
+  }
+  printHelp();
+#if NET_SINK
+  netBegin();
+#endif
+  acquireOwnTask = boardStartTask(acquireTask);
+}
+
+void loop() {
+  if (!acquireOwnTask) acquireStep();
+  {
+    BoardLock lock;
+    cliStep();
+  }
+#if NET_SINK
+  netStep();
+#endif
+  if (acquireOwnTask) delay(1);   // deja pasar a la tarea de adquisición
+}
@@ -0,0 +1,103 @@
+#include "net_sink.h"
+
+#if NET_SINK
+#include <Arduino.h>
+#include <WiFi.h>
+#if NET_SINK == NET_SINK_MQTT
+#include <PubSubClient.h>
+#else
+#include <WiFiUdp.h>
+#endif
+
+#ifndef WIFI_SSID
+#error "NET_SINK necesita -DWIFI_SSID=\"...\" y -DWIFI_PASS=\"...\""
+#endif
+#ifndef NET_HOST
+#error "NET_SINK necesita -DNET_HOST=\"<ip o nombre del servidor>\""
+#endif
+#ifndef NET_PORT
+#define NET_PORT ((NET_SINK == NET_SINK_MQTT) ? 1883 : 5005)
+#endif
+#ifndef MQTT_TOPIC
+#define MQTT_TOPIC "ezo-ec/samples"
+#endif
+
+namespace {
+
+const unsigned long RETRY_MS = 5000;   // entre intentos de (re)conexión
+
+#if NET_SINK == NET_SINK_MQTT
+class MqttSink : public SampleSink {
+ public:
+  MqttSink() : mqtt_(client_) {}
+  bool ready() override {
+    if (WiFi.status() != WL_CONNECTED) return false;
+    if (mqtt_.connected()) {
+      mqtt_.loop();
+      return true;
+    }
+    // Con el TCP ya abierto en la pasada anterior, PubSubClient solo envía
+    // CONNECT y espera el CONNACK (MQTT_SOCKET_TIMEOUT_S como mucho)
+    if (client_.connected()) {
+      char id[20];
+      snprintf(id, sizeof(id), "ezo-ec-%08lx", (unsigned long)random(0x7FFFFFFF));
+      if (mqtt_.connect(id)) return true;
+      client_.stop();
+      return false;
+    }
+    const unsigned long now = millis();
+    if (tried_ && now - lastTryMs_ < RETRY_MS) return false;
+    tried_ = true;
+    lastTryMs_ = now;
+    mqtt_.setServer(NET_HOST, NET_PORT);
+    mqtt_.setBufferSize(NET_PACKET_MAX + 64);   // cabecera MQTT + tópico
+    mqtt_.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+#if defined(ARDUINO_ARCH_ESP32)
+    (void)client_.connect(NET_HOST, NET_PORT, NET_CONNECT_TIMEOUT_MS);
+#else
+    client_.setTimeout(NET_CONNECT_TIMEOUT_MS);
+    (void)client_.connect(NET_HOST, NET_PORT);
+#endif
+    return false;
+  }
+  bool publish(const uint8_t* buf, uint16_t len) override {
+    return mqtt_.publish(MQTT_TOPIC, buf, len);
+  }
+
+ private:
+  WiFiClient client_;
+  PubSubClient mqtt_;
+  bool tried_ = false;
+  unsigned long lastTryMs_ = 0;
+};
+MqttSink sink;
+#else
+class UdpSink : public SampleSink {
+ public:
+  bool ready() override { return WiFi.status() == WL_CONNECTED; }
+  bool publish(const uint8_t* buf, uint16_t len) override {
+    if (!udp_.beginPacket(NET_HOST, NET_PORT)) return false;
+    udp_.write(buf, len);
+    return udp_.endPacket() == 1;
+  }
+
+ private:
+  WiFiUDP udp_;
+};
+UdpSink sink;
+#endif
+
+}  // namespace
+
+void netBegin() {
+  WiFi.mode(WIFI_STA);
+#if defined(ARDUINO_ARCH_ESP32)
+  WiFi.setAutoReconnect(true);
+#endif
+  WiFi.begin(WIFI_SSID, WIFI_PASS);
+}
+
+SampleSink& netSink() { return sink; }
+bool netConnected() { return WiFi.status() == WL_CONNECTED; }
+
+#endif
@@ -0,0 +1,105 @@
+#include "perf.h"
+#include "ec_frame.h"
+#include "board.h"
+
+#if PERF_ENABLED
+
+namespace {
+
+struct PerfStat {
+  uint32_t n;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t sumUs;   // 32 bits se desbordan en ~2 h de RTT de 600 ms
+
+  uint32_t meanUs() const { return n ? (uint32_t)(sumUs / n) : 0; }
+};
+
+PerfStat timers[PERF_TIMER_COUNT];
+uint32_t counters[PERF_COUNTER_COUNT];
+
+const char T_RTT[] PROGMEM = "rtt";
+const char T_PARSE[] PROGMEM = "parse";
+const char T_PRINT[] PROGMEM = "print";
+const char T_LOOP[] PROGMEM = "loop";
+const char* const TIMER_NAMES[PERF_TIMER_COUNT] = { T_RTT, T_PARSE, T_PRINT, T_LOOP };
+
+const char C_MISSED[] PROGMEM = "plazos perdidos";
+const char C_TIMEOUT[] PROGMEM = "timeouts";
+const char C_PARSE[] PROGMEM = "no interpretables";
+const char C_DROPPED[] PROGMEM = "perdidas (continuo)";
+const char* const COUNTER_NAMES[PERF_COUNTER_COUNT] = { C_MISSED, C_TIMEOUT, C_PARSE, C_DROPPED };
+
+const __FlashStringHelper* flash(const char* p) { return reinterpret_cast<const __FlashStringHelper*>(p); }
+
+}  // namespace
+
+void perfAdd(PerfTimerId id, uint32_t us) {
+  PerfStat& s = timers[id];
+  if (s.n == 0 || us < s.minUs) s.minUs = us;
+  if (us > s.maxUs) s.maxUs = us;
+  s.sumUs += us;
+  s.n++;
+}
+
+void perfCount(PerfCounterId id, uint32_t n) { counters[id] += n; }
+
+void perfReset() {
+  memset(timers, 0, sizeof(timers));
+  memset(counters, 0, sizeof(counters));
+}
+
+void perfPrint(Print& out) {
+  for (uint8_t i = 0; i < PERF_TIMER_COUNT; i++) {
+    const PerfStat& s = timers[i];
+    out.print(F("[Perf] "));
+    out.print(flash(TIMER_NAMES[i]));
+    out.print(F(": n="));
+    out.print(s.n);
+    if (s.n) {
+      out.print(F(" min=")); out.print(s.minUs);
+      out.print(F(" max=")); out.print(s.maxUs);
+      out.print(F(" media=")); out.print(s.meanUs());
+      out.print(F(" µs"));
+    }
+    out.println();
+  }
+  for (uint8_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+    out.print(F("[Perf] "));
+    out.print(flash(COUNTER_NAMES[i]));
+    out.print(F(": "));
+    out.println(counters[i]);
+  }
+  out.print(F("[Perf] RAM libre mín.: "));
+  out.print(boardFreeRamMin());
+  out.println(F(" bytes"));
+}
+
+uint8_t perfFrame(uint8_t* out) {
+  uint8_t* p = out;
+  *p++ = PERF_FRAME_SYNC;
+  putLe(p, millis(), 4);
+  p += 4;
+  for (const PerfStat& s : timers) {
+    putLe(p, s.n, 4);
+    putLe(p + 4, s.minUs, 4);
+    putLe(p + 8, s.maxUs, 4);
+    putLe(p + 12, s.meanUs(), 4);
+    p += 16;
+  }
+  for (uint32_t c : counters) {
+    putLe(p, c, 4);
+    p += 4;
+  }
+  putLe(p, boardFreeRamMin(), 4);
+  p += 4;
+  *p = crc8(out + 1, (uint16_t)(p - out - 1));
+  return PERF_FRAME_LEN;
+}
+
+#else
+
+void perfPrint(Print& out) { out.println(F("[Perf] No compilado (PERF_ENABLED=0)")); }
+uint8_t perfFrame(uint8_t*) { return 0; }
+
+#endif
@@ -0,0 +1,62 @@
+#include "power.h"
+#include <Arduino.h>
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+// Contadores de wiring.c; se adelantan a mano tras cada tramo dormido
+extern volatile unsigned long timer0_millis;
+extern volatile unsigned long timer0_overflow_count;
+
+ISR(WDT_vect) {}   // solo despierta
+
+namespace {
+
+// Tramos del watchdog en ms para WDP = 0..9
+const uint16_t WDT_MS[] = { 16, 32, 64, 125, 250, 500, 1000, 2000, 4000, 8000 };
+
+void sleepWdt(uint8_t wdp) {
+  const uint8_t bits = (uint8_t)(((wdp & 8) ? _BV(WDP3) : 0) | (wdp & 7));
+  cli();
+  MCUSR &= (uint8_t)~_BV(WDRF);
+  WDTCSR = _BV(WDCE) | _BV(WDE);
+  WDTCSR = (uint8_t)(_BV(WDIE) | bits);   // interrupción, sin reset
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  sleep_bod_disable();
+  sei();
+  sleep_cpu();
+  sleep_disable();
+  wdt_disable();
+}
+
+void addMillis(uint16_t ms) {
+  cli();
+  timer0_millis += ms;
+  timer0_overflow_count += ((uint32_t)ms * 125UL) / 128UL;   // un desborde = 1.024 ms
+  sei();
+}
+
+}  // namespace
+
+void powerDown(uint32_t ms) {
+  const uint8_t adcsra = ADCSRA;
+  ADCSRA = 0;   // el ADC encendido consume en power-down
+  while (ms >= WDT_MS[0]) {
+    uint8_t wdp = 9;
+    while (WDT_MS[wdp] > ms) wdp--;
+    sleepWdt(wdp);
+    addMillis(WDT_MS[wdp]);
+    ms -= WDT_MS[wdp];
+  }
+  ADCSRA = adcsra;
+  if (ms) delay(ms);
+}
+
+#else
+
+void powerDown(uint32_t ms) { delay(ms); }
+
+#endif
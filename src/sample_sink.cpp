@@ -0,0 +1,68 @@
+#include "sample_sink.h"
+#include <stdio.h>
+#include "ec_frame.h"
+#include "ezo_parse.h"
+
+namespace {
+
+const uint16_t JSON_SAMPLE_MAX = 40;   // "[65535,4294967295,15,-2147483648],"
+const uint16_t JSON_TAIL_MAX = 12;     // "]," "\"n\":255}"
+
+}  // namespace
+
+void SampleBatcher::configure(uint8_t batch, uint32_t flushMs, SinkFormat fmt) {
+  batch_ = batch ? batch : 1;
+  flushMs_ = flushMs;
+  fmt_ = fmt;
+}
+
+void SampleBatcher::commit(uint8_t n, bool ok, unsigned long nowMs) {
+  lastFlushMs_ = nowMs;
+  if (!ok) {
+    failures_++;
+    retrying_ = true;
+    retryAtMs_ = nowMs + flushMs_;
+    return;
+  }
+  retrying_ = false;
+  next_ = (uint16_t)(next_ + n);
+  sent_ += n;
+  packets_++;
+  dropPending_ = 0;
+}
+
+void SampleBatcher::begin(uint8_t* out, uint16_t cap) {
+  out_ = out;
+  cap_ = cap;
+  n_ = 0;
+  if (fmt_ == SINK_BIN) {
+    out_[0] = SINK_PACKET_SYNC;
+    putLe(out_ + 2, dropPending_, 2);
+    len_ = SINK_HEADER_LEN;
+  } else {
+    len_ = (uint16_t)snprintf((char*)out_, cap_, "{\"drop\":%u,\"s\":[", (unsigned)dropPending_);
+  }
+}
+
+bool SampleBatcher::add(const Sample& s, uint16_t seq) {
+  if (fmt_ == SINK_BIN) {
+    if (len_ + EC_FRAME_LEN > cap_) return false;
+    ecFrameEncode(out_ + len_, seq, s.ms, s.ecMilli, 0, ecFrameFlags(EC_FIELD_EC, s.probe()));
+    len_ += EC_FRAME_LEN;
+  } else {
+    if (len_ + JSON_SAMPLE_MAX + JSON_TAIL_MAX > cap_) return false;
+    len_ += (uint16_t)snprintf((char*)out_ + len_, cap_ - len_, "%s[%u,%lu,%u,%ld]", n_ ? "," : "",
+                               (unsigned)seq, (unsigned long)s.ms, (unsigned)s.probe(), (long)s.ecMilli);
+  }
+  n_++;
+  return true;
+}
+
+uint16_t SampleBatcher::end() {
+  if (fmt_ == SINK_BIN) {
+    out_[1] = n_;
+  } else {
+    len_ += (uint16_t)snprintf((char*)out_ + len_, cap_ - len_, "],\"n\":%u}", (unsigned)n_);
+  }
+  return len_;
+}
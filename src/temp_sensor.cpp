@@ -0,0 +1,52 @@
+#include "temp_sensor.h"
+
+#if TEMP_SENSOR
+
+namespace {
+
+const uint8_t CMD_CONVERT = 0x44;
+const uint8_t CMD_READ_SCRATCHPAD = 0xBE;
+const int16_t POWER_ON_RAW = 0x0550;   // 85 °C: valor de reset, no una medida
+
+}  // namespace
+
+bool Ds18b20::startConversion() {
+  if (!bus_.reset()) return false;   // nadie respondió al pulso de presencia
+  bus_.skip();
+  bus_.write(CMD_CONVERT);
+  return true;
+}
+
+bool Ds18b20::readScratchpad(int16_t& centi) {
+  if (!bus_.reset()) return false;
+  bus_.skip();
+  bus_.write(CMD_READ_SCRATCHPAD);
+  uint8_t d[9];
+  bus_.read_bytes(d, sizeof(d));
+  if (OneWire::crc8(d, 8) != d[8]) return false;
+  const int16_t raw = (int16_t)((d[1] << 8) | d[0]);   // 1/16 °C
+  if (raw == POWER_ON_RAW) return false;
+  centi = (int16_t)(((int32_t)raw * 25) / 4);
+  return true;
+}
+
+bool Ds18b20::poll(unsigned long nowMs, bool quiet) {
+  if (!converting_) {
+    if (nowMs - startMs_ < TEMP_PERIOD_MS || !quiet) return false;
+    startMs_ = nowMs;
+    if (startConversion()) converting_ = true;
+    else errors_++;
+    return false;
+  }
+  if (nowMs - startMs_ < CONVERSION_MS || !quiet) return false;
+  converting_ = false;
+  int16_t t;
+  if (!readScratchpad(t)) {
+    errors_++;
+    return false;
+  }
+  centi_ = t;
+  return true;
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Sustituto mínimo de Arduino.h para [env:native]: lo justo para compilar
+ * el parser, la CLI, EzoLink y el transporte UART en el PC. millis() lee
+ * un reloj simulado que avanzan las pruebas (sim::advance).
+ */
+#pragma once
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define memcpy_P memcpy
+#define strcasecmp_P strcasecmp
+#define strncasecmp_P strncasecmp
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+
+namespace sim {
+inline unsigned long& now() {
+  static unsigned long ms = 0;
+  return ms;
+}
+inline void advance(unsigned long ms) { now() += ms; }
+}  // namespace sim
+
+inline unsigned long millis() { return sim::now(); }
+inline unsigned long micros() { return sim::now() * 1000UL; }
+inline bool isDigit(int c) { return isdigit(c) != 0; }
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t write(const uint8_t* b, size_t n) {
+    for (size_t i = 0; i < n; i++) write(b[i]);
+    return n;
+  }
+  size_t print(const char* s) { return write(s); }
+  size_t print(const __FlashStringHelper* s) { return write(reinterpret_cast<const char*>(s)); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned long v) {
+    char b[24];
+    snprintf(b, sizeof(b), "%lu", v);
+    return write(b);
+  }
+  size_t print(long v) {
+    char b[24];
+    snprintf(b, sizeof(b), "%ld", v);
+    return write(b);
+  }
+  size_t print(int v) { return print((long)v); }
+  size_t print(unsigned v) { return print((unsigned long)v); }
+  size_t println() { return write("\r\n"); }
+  template <class T> size_t println(T v) { return print(v) + println(); }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+};
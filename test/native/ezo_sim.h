@@ -0,0 +1,162 @@
+/*
+ * EZO EC simulado para las pruebas en el PC. Se conecta como Stream a
+ * EzoUartTransport: recibe comandos terminados en '\r' y, tras la latencia
+ * de proceso del comando (con jitter), entrega la respuesta byte a byte al
+ * ritmo de 9600 baudios (~1 ms por byte), seguida del "*OK" como el real.
+ * Puede inyectar ruido (bytes no imprimibles) y perder respuestas, y emitir
+ * lecturas espontáneas en modo continuo (C,n), también desde el arranque.
+ *
+ * El modelo de comandos es propio del simulador, a partir del datasheet, y
+ * no reutiliza ezo_response.h: así las pruebas no validan el firmware
+ * contra sí mismo.
+ */
+#pragma once
+#include <Arduino.h>
+#include <deque>
+#include <string>
+
+struct EzoSimConfig {
+  uint16_t readMs = 600;       // R, RT
+  uint16_t calMs = 600;        // Cal,...
+  uint16_t otherMs = 300;      // resto de comandos
+  uint16_t jitterMs = 20;      // ± uniforme sobre la latencia
+  uint8_t noisePct = 0;        // % de respuestas con un byte basura intercalado
+  uint8_t dropPct = 0;         // % de comandos que no reciben respuesta
+  bool okCodes = true;         // "*OK" tras cada respuesta (por defecto en el EZO)
+};
+
+class EzoSim : public Stream {
+ public:
+  explicit EzoSim(uint32_t seed = 12345) : rng_(seed ? seed : 1) {}
+
+  EzoSimConfig cfg;
+  std::string readLine = "1413";   // respuesta a R/RT
+
+  size_t write(uint8_t c) override {
+    if (c == '\r') {
+      respond(cmd_);
+      cmd_.clear();
+    } else {
+      cmd_ += (char)c;
+    }
+    return 1;
+  }
+
+  // El EZO arranca ya en C,s (el modo se guarda en el propio EZO)
+  void startContinuous(uint8_t s) {
+    contS_ = s;
+    nextContMs_ = millis() + s * 1000UL;
+  }
+
+  int available() override {
+    tick();
+    int n = 0;
+    for (const Byte& b : out_) {
+      if (b.atMs > millis()) break;
+      n++;
+    }
+    return n;
+  }
+
+  int read() override {
+    tick();
+    if (out_.empty() || out_.front().atMs > millis()) return -1;
+    const uint8_t c = out_.front().c;
+    out_.pop_front();
+    return c;
+  }
+
+  uint32_t commands() const { return commands_; }
+  const std::string& lastCommand() const { return last_; }
+  float temperature() const { return temp_; }
+
+ private:
+  struct Byte {
+    unsigned long atMs;
+    uint8_t c;
+  };
+
+  static bool startsWith(const std::string& s, const char* p) { return strncasecmp(s.c_str(), p, strlen(p)) == 0; }
+  static bool equals(const std::string& s, const char* p) { return strcasecmp(s.c_str(), p) == 0; }
+
+  uint32_t next() {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return rng_;
+  }
+  bool chance(uint8_t pct) { return pct > 0 && next() % 100 < pct; }
+
+  // Lecturas del modo continuo que ya tocaban
+  void tick() {
+    while (contS_ && nextContMs_ <= millis()) {
+      enqueue(readLine, nextContMs_);
+      nextContMs_ += contS_ * 1000UL;
+    }
+  }
+
+  void respond(const std::string& cmd) {
+    commands_++;
+    last_ = cmd;
+    if (chance(cfg.dropPct)) return;
+
+    uint16_t latency = cfg.otherMs;
+    std::string data;
+    bool error = false;
+    if (equals(cmd, "R") || startsWith(cmd, "RT,")) {
+      if (cmd.size() > 3) temp_ = (float)atof(cmd.c_str() + 3);
+      latency = cfg.readMs;
+      data = readLine;
+    } else if (startsWith(cmd, "T,") && cmd.find('?') == std::string::npos) {
+      temp_ = (float)atof(cmd.c_str() + 2);
+    } else if (equals(cmd, "T,?")) {
+      char b[16];
+      snprintf(b, sizeof(b), "?T,%.2f", temp_);
+      data = b;
+    } else if (equals(cmd, "C,?")) {
+      data = "?C," + std::to_string(contS_);
+    } else if (startsWith(cmd, "C,")) {
+      startContinuous((uint8_t)atoi(cmd.c_str() + 2));
+    } else if (equals(cmd, "O,?")) {
+      data = "?O,EC";
+    } else if (equals(cmd, "I")) {
+      data = "?I,EC,2.16";
+    } else if (equals(cmd, "Status")) {
+      data = "?Status,P,5.02";
+    } else if (startsWith(cmd, "Cal,")) {
+      if (cmd.find('?') != std::string::npos) data = "?Cal,2";
+      else latency = cfg.calMs;
+    } else if (cmd.empty() || !isalpha((unsigned char)cmd[0])) {
+      error = true;
+    }
+
+    unsigned long at = millis() + latency;
+    if (cfg.jitterMs > 0) at = at - cfg.jitterMs + next() % (2u * cfg.jitterMs + 1);
+    if (error) {
+      at = enqueue("*ER", at);
+      return;
+    }
+    if (!data.empty()) at = enqueue(data, at);
+    if (cfg.okCodes) enqueue("*OK", at);
+  }
+
+  // Encola text + '\r' a ~1 ms por byte desde atMs; devuelve el final
+  unsigned long enqueue(const std::string& text, unsigned long atMs) {
+    const size_t noiseAt = chance(cfg.noisePct) ? next() % (text.size() + 1) : std::string::npos;
+    if (!out_.empty() && out_.back().atMs >= atMs) atMs = out_.back().atMs + 1;
+    for (size_t i = 0; i <= text.size(); i++) {
+      if (i == noiseAt) out_.push_back({atMs++, (uint8_t)(0x80 | (next() & 0x7F))});
+      out_.push_back({atMs++, (uint8_t)(i < text.size() ? text[i] : '\r')});
+    }
+    return atMs;
+  }
+
+  uint32_t rng_;
+  std::string cmd_;
+  std::string last_;
+  std::deque<Byte> out_;
+  uint32_t commands_ = 0;
+  uint8_t contS_ = 0;             // 0 = sin modo continuo
+  unsigned long nextContMs_ = 0;
+  float temp_ = 25.0f;
+};
@@ -0,0 +1,178 @@
+/*
+ * Benchmarks en el PC (pio test -e native -f test_bench). Los tiempos de
+ * CPU son del host y solo sirven como referencia relativa, con cotas holgadas;
+ * la latencia y la tasa de muestreo se miden en tiempo simulado y son
+ * deterministas, así que una regresión del motor de EzoLink falla siempre.
+ */
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include "cli.h"
+#include "ezo_grid.h"
+#include "ezo_link.h"
+#include "ezo_parse.h"
+#include "ezo_sim.h"
+
+#ifndef BENCH_PARSE_MAX_NS
+#define BENCH_PARSE_MAX_NS 1000   // por línea, en el host
+#endif
+#ifndef BENCH_CLI_MAX_NS
+#define BENCH_CLI_MAX_NS 2000     // por despacho, en el host
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double nsPerOp(Clock::time_point t0, Clock::time_point t1, unsigned long ops) {
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)ops;
+}
+
+volatile uint32_t sink;   // evita que el compilador elimine el trabajo
+
+// Mismo planificador que loop(): un R en vuelo como mucho, en la rejilla
+// fija de EzoReadGrid
+struct Streamer {
+  EzoSim ezo;
+  EzoUartTransport port{ezo};
+  EzoLink link{port};
+  bool inFlight = false;
+  EzoReadGrid grid;
+  unsigned long firstSentMs = 0;
+  unsigned long lastSentMs = 0;
+  unsigned long samples = 0;
+  unsigned long latencySum = 0;
+  unsigned long latencyMax = 0;
+
+  static void onRead(EzoLink& link, EzoStatus status, const char*, const char* resp, uint8_t len, void* ctx) {
+    Streamer& s = *static_cast<Streamer*>(ctx);
+    s.inFlight = false;
+    if (s.samples == 0) s.firstSentMs = link.lastSentMs();
+    s.lastSentMs = link.lastSentMs();
+    EcReading rd;
+    if (status != EZO_OK || ezoParseLine(resp, len, rd) == 0) return;
+    const unsigned long latency = millis() - link.lastSentMs();
+    s.samples++;
+    s.latencySum += latency;
+    if (latency > s.latencyMax) s.latencyMax = latency;
+  }
+
+  void run(unsigned long periodMs, unsigned long durationMs) {
+    const unsigned long end = millis() + durationMs;
+    grid.start(millis());
+    while (millis() < end) {
+      sim::advance(1);
+      link.poll();
+      const unsigned long now = millis();
+      if (!inFlight && grid.due(now) && link.submit("R", EZO_TIMEOUT_AUTO, onRead, this)) {
+        inFlight = true;
+        (void)grid.advance(now, periodMs);
+      }
+    }
+  }
+};
+
+void dummy(uint8_t argc, char**) { sink += argc; }
+
+#define CMD(id, name) const char id[] PROGMEM = name;
+CMD(C0, "help") CMD(C1, "r") CMD(C2, "t") CMD(C3, "cal") CMD(C4, "k") CMD(C5, "o")
+CMD(C6, "stream") CMD(C7, "period") CMD(C8, "raw") CMD(C9, "fmt") CMD(C10, "log")
+CMD(C11, "dump") CMD(C12, "i") CMD(C13, "status") CMD(C14, "led") CMD(C15, "factory")
+CMD(C16, "sleep") CMD(C17, "c") CMD(C18, "p") CMD(C19, "batch")
+#undef CMD
+const char USAGE[] PROGMEM = "-";
+const CliCommand TABLE[] PROGMEM = {
+  {C0, USAGE, 0, 4, dummy},  {C1, USAGE, 0, 4, dummy},  {C2, USAGE, 0, 4, dummy},
+  {C3, USAGE, 0, 4, dummy},  {C4, USAGE, 0, 4, dummy},  {C5, USAGE, 0, 4, dummy},
+  {C6, USAGE, 0, 4, dummy},  {C7, USAGE, 0, 4, dummy},  {C8, USAGE, 0, 4, dummy},
+  {C9, USAGE, 0, 4, dummy},  {C10, USAGE, 0, 4, dummy}, {C11, USAGE, 0, 4, dummy},
+  {C12, USAGE, 0, 4, dummy}, {C13, USAGE, 0, 4, dummy}, {C14, USAGE, 0, 4, dummy},
+  {C15, USAGE, 0, 4, dummy}, {C16, USAGE, 0, 4, dummy}, {C17, USAGE, 0, 4, dummy},
+  {C18, USAGE, 0, 4, dummy}, {C19, USAGE, 0, 4, dummy},
+};
+
+struct NullOut : Print {
+  size_t write(uint8_t) override { return 1; }
+};
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+static void bench_parse_throughput() {
+  static const char* const LINES[] = {
+    "1413.25", "EC,1413.25,TDS,763,SAL,0.70,SG,1.000", "12880,6955,7.37,1.005", "*OK",
+  };
+  const unsigned long n = 200000;
+  EcReading rd;
+  const Clock::time_point t0 = Clock::now();
+  for (unsigned long i = 0; i < n; i++) {
+    const char* s = LINES[i & 3];
+    sink += ezoParseLine(s, (uint8_t)strlen(s), rd);
+  }
+  const double ns = nsPerOp(t0, Clock::now(), n);
+  printf("[bench] parse: %.1f ns/línea (cota %d)\n", ns, BENCH_PARSE_MAX_NS);
+  TEST_ASSERT_LESS_THAN(BENCH_PARSE_MAX_NS, (int)ns);
+}
+
+static void bench_cli_dispatch() {
+  const unsigned long n = 100000;
+  NullOut out;
+  const Clock::time_point t0 = Clock::now();
+  for (unsigned long i = 0; i < n; i++) {
+    char line[] = "batch begin";   // último de la tabla: peor caso de la búsqueda
+    TEST_ASSERT_EQUAL(CLI_OK, cliDispatch(TABLE, 20, line, out));
+  }
+  const double ns = nsPerOp(t0, Clock::now(), n);
+  printf("[bench] cli: %.1f ns/despacho (cota %d)\n", ns, BENCH_CLI_MAX_NS);
+  TEST_ASSERT_LESS_THAN(BENCH_CLI_MAX_NS, (int)ns);
+}
+
+static void bench_sample_latency() {
+  Streamer s;
+  s.run(1000, 60000);
+  TEST_ASSERT_GREATER_THAN(50, s.samples);
+  const unsigned long mean = s.latencySum / s.samples;
+  printf("[bench] latencia R→muestra: media %lu ms, máx %lu ms\n", mean, s.latencyMax);
+  // conversión + jitter + "1413\r" a ~1 ms por byte; nada de esperas fijas
+  const unsigned long bound = s.ezo.cfg.readMs + s.ezo.cfg.jitterMs + s.ezo.readLine.size() + 3;
+  TEST_ASSERT_LESS_OR_EQUAL(bound, s.latencyMax);
+}
+
+static void bench_sample_rate() {
+  static const unsigned long PERIODS[] = { 100, 250, 500, 1000, 2000 };
+  const unsigned long durationMs = 60000;
+  for (unsigned long period : PERIODS) {
+    Streamer s;
+    s.run(period, durationMs);
+    // el ciclo mínimo es la conversión más el "*OK" que cierra la transacción
+    const unsigned long cycle = s.ezo.cfg.readMs + s.ezo.readLine.size() + 6;
+    const double expected = (double)durationMs / (double)(period > cycle ? period : cycle);
+    const double achieved = (double)s.samples;
+    printf("[bench] period %4lu ms: %5.2f muestras/s (esperado %5.2f)\n", period,
+           achieved * 1000.0 / durationMs, expected * 1000.0 / durationMs);
+    TEST_ASSERT_GREATER_OR_EQUAL((unsigned long)(expected * 0.95), s.samples);
+  }
+}
+
+static void bench_schedule_has_no_drift() {
+  // 1 h a 1 s: las peticiones siguen en la rejilla aunque cada RTT varíe
+  Streamer s;
+  s.ezo.cfg.jitterMs = 150;
+  s.run(1000, 3600000UL);
+  const long drift = (long)(s.lastSentMs - s.firstSentMs) - (long)(s.samples - 1) * 1000L;
+  printf("[bench] deriva tras %lu muestras: %ld ms\n", s.samples, drift);
+  TEST_ASSERT_EQUAL(3600, s.samples);
+  TEST_ASSERT_INT32_WITHIN(2, 0, drift);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(bench_parse_throughput);
+  RUN_TEST(bench_cli_dispatch);
+  RUN_TEST(bench_sample_latency);
+  RUN_TEST(bench_sample_rate);
+  RUN_TEST(bench_schedule_has_no_drift);
+  return UNITY_END();
+}
@@ -0,0 +1,89 @@
+// CLI por tabla (cli.h): troceo, despacho y guion del modo batch
+#include <unity.h>
+#include <string>
+#include "cli.h"
+
+namespace {
+
+struct Capture : Print {
+  std::string text;
+  size_t write(uint8_t c) override { text += (char)c; return 1; }
+};
+
+uint8_t lastArgc = 0;
+std::string lastArg1;
+
+void onSet(uint8_t argc, char** argv) {
+  lastArgc = argc;
+  lastArg1 = argc > 1 ? argv[1] : "";
+}
+
+const char N_SET[] PROGMEM = "set";
+const char U_SET[] PROGMEM = "set <a> [b]";
+const CliCommand TABLE[] PROGMEM = {
+  { N_SET, U_SET, 1, 2, onSet },
+};
+
+}  // namespace
+
+void setUp() {
+  lastArgc = 0;
+  lastArg1.clear();
+}
+void tearDown() {}
+
+static void test_tokenize_collapses_spaces() {
+  char line[] = "  cal   mid\t1413 ";
+  char* argv[4];
+  TEST_ASSERT_EQUAL_UINT8(3, cliTokenize(line, argv, 4));
+  TEST_ASSERT_EQUAL_STRING("cal", argv[0]);
+  TEST_ASSERT_EQUAL_STRING("1413", argv[2]);
+}
+
+static void test_dispatch_is_case_insensitive() {
+  Capture out;
+  char line[] = "SET on";
+  TEST_ASSERT_EQUAL(CLI_OK, cliDispatch(TABLE, 1, line, out));
+  TEST_ASSERT_EQUAL_UINT8(2, lastArgc);
+  TEST_ASSERT_EQUAL_STRING("on", lastArg1.c_str());
+}
+
+static void test_dispatch_reports_usage_and_unknown() {
+  Capture out;
+  char bad[] = "set";
+  TEST_ASSERT_EQUAL(CLI_USAGE, cliDispatch(TABLE, 1, bad, out));
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, out.text.find("set <a> [b]"));
+  char unknown[] = "nope";
+  TEST_ASSERT_EQUAL(CLI_UNKNOWN, cliDispatch(TABLE, 1, unknown, out));
+  char empty[] = "   ";
+  TEST_ASSERT_EQUAL(CLI_EMPTY, cliDispatch(TABLE, 1, empty, out));
+  TEST_ASSERT_EQUAL_UINT8(0, lastArgc);
+}
+
+static void test_batch_splits_on_semicolons() {
+  CliBatch b;
+  TEST_ASSERT_TRUE(b.append("o ec on; k 1.0 ;; t 25"));
+  TEST_ASSERT_EQUAL_UINT8(3, b.count());
+  TEST_ASSERT_EQUAL_STRING("o ec on", b.next());
+  TEST_ASSERT_EQUAL_STRING("k 1.0", b.next());
+  TEST_ASSERT_EQUAL_STRING("t 25", b.next());
+  TEST_ASSERT_NULL(b.next());
+}
+
+static void test_batch_rejects_overflow_whole() {
+  CliBatch b;
+  std::string big(CLI_BATCH_MAX, 'x');
+  TEST_ASSERT_TRUE(b.append("r"));
+  TEST_ASSERT_FALSE(b.append(big.c_str()));
+  TEST_ASSERT_EQUAL_UINT8(1, b.count());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_tokenize_collapses_spaces);
+  RUN_TEST(test_dispatch_is_case_insensitive);
+  RUN_TEST(test_dispatch_reports_usage_and_unknown);
+  RUN_TEST(test_batch_splits_on_semicolons);
+  RUN_TEST(test_batch_rejects_overflow_whole);
+  return UNITY_END();
+}
@@ -0,0 +1,35 @@
+// Magnitudes derivadas de la EC (ec_derived.h)
+#include <unity.h>
+#include "ec_derived.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_salinity_seawater() {
+  // agua de mar estándar: 35 PSU ≈ 53.087 mS/cm a 25 °C
+  TEST_ASSERT_INT32_WITHIN(30, 35000, ecSalinityMilli(53087000));
+  TEST_ASSERT_INT32_WITHIN(15, 492, ecSalinityMilli(1000000));   // nodo
+}
+
+static void test_salinity_interpolates_and_clamps() {
+  const int32_t lo = ecSalinityMilli(17000000), hi = ecSalinityMilli(18000000);
+  TEST_ASSERT_TRUE(lo > 8718 && lo < hi && hi < 11917);
+  TEST_ASSERT_EQUAL_INT32(0, ecSalinityMilli(0));
+  TEST_ASSERT_EQUAL_INT32(0, ecSalinityMilli(-500));
+  TEST_ASSERT_TRUE(ecSalinityMilli(65000000) > 40207);   // extrapola el último tramo
+}
+
+static void test_resistivity() {
+  TEST_ASSERT_EQUAL_INT32(18182, ecResistivityMilli(55));     // 0.055 µS/cm
+  TEST_ASSERT_EQUAL_INT32(1000, ecResistivityMilli(1000));    // 1 µS/cm
+  TEST_ASSERT_EQUAL_INT32(1, ecResistivityMilli(1413000));    // patrón de 1413
+  TEST_ASSERT_EQUAL_INT32(EC_RES_OPEN, ecResistivityMilli(0));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_salinity_seawater);
+  RUN_TEST(test_salinity_interpolates_and_clamps);
+  RUN_TEST(test_resistivity);
+  return UNITY_END();
+}
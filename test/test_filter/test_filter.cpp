@@ -0,0 +1,61 @@
+// Filtro y decimación de EC (ec_filter.h), en milésimas
+#include <unity.h>
+#include "ec_filter.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_off_passes_every_sample() {
+  EcFilter f;
+  int32_t out = 0;
+  TEST_ASSERT_FALSE(f.active());
+  TEST_ASSERT_TRUE(f.push(1234, out));
+  TEST_ASSERT_EQUAL_INT32(1234, out);
+}
+
+static void test_mean_with_decimation_emits_one_per_block() {
+  EcFilter f;
+  f.configure(EC_FILTER_MEAN, 4, 4);
+  int32_t out = 0;
+  int emitted = 0;
+  for (int32_t i = 1; i <= 12; i++) {
+    if (f.push(i * 1000, out)) emitted++;
+  }
+  TEST_ASSERT_EQUAL(3, emitted);
+  TEST_ASSERT_EQUAL_INT32(10500, out);   // media de 9..12
+}
+
+static void test_median_rejects_spike() {
+  EcFilter f;
+  f.configure(EC_FILTER_MEDIAN, 5, 1);
+  const int32_t in[] = { 1000, 1010, 990, 250000, 1005 };
+  int32_t out = 0;
+  for (int32_t x : in) TEST_ASSERT_TRUE(f.push(x, out));
+  TEST_ASSERT_EQUAL_INT32(1005, out);
+}
+
+static void test_ewma_converges_and_handles_negatives() {
+  EcFilter f;
+  f.configure(EC_FILTER_EWMA, 8, 1);
+  int32_t out = 0;
+  f.push(0, out);
+  for (int i = 0; i < 200; i++) f.push(-5000, out);
+  TEST_ASSERT_INT32_WITHIN(4, -5000, out);
+}
+
+static void test_window_is_clamped() {
+  EcFilter f;
+  f.configure(EC_FILTER_MEAN, 200, 0);
+  TEST_ASSERT_EQUAL_UINT8(EC_FILTER_MAX, f.length());
+  TEST_ASSERT_EQUAL_UINT8(1, f.decimation());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_off_passes_every_sample);
+  RUN_TEST(test_mean_with_decimation_emits_one_per_block);
+  RUN_TEST(test_median_rejects_spike);
+  RUN_TEST(test_ewma_converges_and_handles_negatives);
+  RUN_TEST(test_window_is_clamped);
+  return UNITY_END();
+}
@@ -0,0 +1,222 @@
+// EzoLink + EzoUartTransport contra el EZO simulado: *OK tras los datos,
+// plazos adaptativos y ruido en la línea
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "ezo_cache.h"
+#include "ezo_health.h"
+#include "ezo_link.h"
+#include "ezo_sim.h"
+
+namespace {
+
+struct Reply {
+  std::string cmd;
+  EzoStatus status;
+  std::string resp;
+  unsigned long atMs;
+};
+std::vector<Reply> replies;
+
+void record(EzoLink&, EzoStatus status, const char* cmd, const char* resp, uint8_t len, void*) {
+  replies.push_back({cmd, status, std::string(resp, len), millis()});
+}
+
+void run(EzoLink& link, unsigned long ms) {
+  for (unsigned long i = 0; i < ms; i++) {
+    sim::advance(1);
+    link.poll();
+  }
+}
+
+}  // namespace
+
+void setUp() { replies.clear(); }
+void tearDown() {}
+
+static void test_data_reply_then_ok_is_consumed() {
+  EzoSim ezo;
+  EzoUartTransport port(ezo);
+  EzoLink link(port);
+  TEST_ASSERT_TRUE(link.submit("R", EZO_TIMEOUT_AUTO, record));
+  TEST_ASSERT_TRUE(link.submit("T,25.00", EZO_TIMEOUT_AUTO, record));
+  TEST_ASSERT_TRUE(link.submit("I", EZO_TIMEOUT_AUTO, record));
+  run(link, 3000);
+  TEST_ASSERT_EQUAL(3, replies.size());
+  TEST_ASSERT_EQUAL_STRING("1413", replies[0].resp.c_str());
+  TEST_ASSERT_EQUAL_STRING("*OK", replies[1].resp.c_str());   // no el *OK del R
+  TEST_ASSERT_EQUAL_STRING("?I,EC,2.16", replies[2].resp.c_str());
+  for (const Reply& r : replies) TEST_ASSERT_EQUAL(EZO_OK, r.status);
+  TEST_ASSERT_FALSE(link.busy());
+}
+
+static void test_continuous_mode_is_stopped_before_queries() {
+  // EZO que se quedó en C,1 antes del reinicio de la placa: la secuencia de
+  // arranque manda C,0 antes del primer ?, y las lecturas que lleguen
+  // mientras tanto no se toman como la respuesta de O,? ni de I
+  EzoSim ezo;
+  ezo.startContinuous(1);
+  EzoUartTransport port(ezo);
+  EzoLink link(port);
+  run(link, 950);
+  TEST_ASSERT_TRUE(link.submit("C,0", EZO_TIMEOUT_AUTO, record));
+  TEST_ASSERT_TRUE(link.submit("O,?", EZO_TIMEOUT_AUTO, record));
+  TEST_ASSERT_TRUE(link.submit("I", EZO_TIMEOUT_AUTO, record));
+  run(link, 4000);
+  TEST_ASSERT_EQUAL(3, replies.size());
+  TEST_ASSERT_EQUAL_STRING("*OK", replies[0].resp.c_str());
+  TEST_ASSERT_EQUAL_STRING("?O,EC", replies[1].resp.c_str());
+  TEST_ASSERT_EQUAL_STRING("?I,EC,2.16", replies[2].resp.c_str());
+  for (const Reply& r : replies) TEST_ASSERT_EQUAL(EZO_OK, r.status);
+  TEST_ASSERT_FALSE(link.busy());
+}
+
+static void test_error_code_ends_transaction() {
+  EzoSim ezo;
+  EzoUartTransport port(ezo);
+  EzoLink link(port);
+  const unsigned long t0 = millis();
+  link.submit("#bad", EZO_TIMEOUT_AUTO, record);
+  run(link, 1000);
+  TEST_ASSERT_EQUAL(1, replies.size());
+  TEST_ASSERT_EQUAL_STRING("*ER", replies[0].resp.c_str());
+  TEST_ASSERT_LESS_THAN(400, replies[0].atMs - t0);
+  TEST_ASSERT_FALSE(link.busy());
+}
+
+static void test_adaptive_timeout_fails_fast_when_disconnected() {
+  EzoSim ezo;
+  EzoUartTransport port(ezo);
+  EzoLink link(port);
+  for (int i = 0; i < 20; i++) {
+    link.submit("L,1", EZO_TIMEOUT_AUTO, record);
+    run(link, 400);
+  }
+  const EzoLatency& lat = link.latency(EZO_CMD_SET);
+  TEST_ASSERT_EQUAL(20, lat.samples());
+  const uint16_t worst = ezoWorstCaseMs(EZO_CMD_SET);
+  TEST_ASSERT_LESS_THAN(worst, lat.timeoutMs(worst));
+
+  ezo.cfg.dropPct = 100;   // sonda desconectada
+  replies.clear();
+  const unsigned long t0 = millis();
+  link.submit("L,1", EZO_TIMEOUT_AUTO, record);
+  run(link, worst + 100);
+  TEST_ASSERT_EQUAL(1, replies.size());
+  TEST_ASSERT_EQUAL(EZO_TIMEOUT, replies[0].status);
+  TEST_ASSERT_LESS_THAN(worst / 2, replies[0].atMs - t0);
+  // tras el timeout se vuelve al peor caso hasta reaprender
+  TEST_ASSERT_EQUAL(worst, lat.timeoutMs(worst));
+}
+
+static void test_late_reply_after_timeout_is_drained() {
+  EzoSim ezo;
+  ezo.cfg.jitterMs = 0;
+  EzoUartTransport port(ezo);
+  EzoLink link(port);
+  for (int i = 0; i < 10; i++) {
+    link.submit("R", EZO_TIMEOUT_AUTO, record);
+    run(link, 1000);
+  }
+  const uint16_t learned = link.latency(EZO_CMD_READ).timeoutMs(ezoWorstCaseMs(EZO_CMD_READ));
+  TEST_ASSERT_LESS_THAN(ezoWorstCaseMs(EZO_CMD_READ) - 100, learned);
+
+  // el EZO se ralentiza: el R vence y su "1413" + *OK llegan justo después
+  ezo.cfg.readMs = learned + 30;
+  replies.clear();
+  TEST_ASSERT_TRUE(link.submit("R", EZO_TIMEOUT_AUTO, record));
+  TEST_ASSERT_TRUE(link.submit("T,?", EZO_TIMEOUT_AUTO, record));
+  TEST_ASSERT_TRUE(link.submit("R", EZO_TIMEOUT_AUTO, record));
+  run(link, 4000);
+  TEST_ASSERT_EQUAL(3, replies.size());
+  TEST_ASSERT_EQUAL(EZO_TIMEOUT, replies[0].status);
+  TEST_ASSERT_EQUAL(EZO_OK, replies[1].status);
+  TEST_ASSERT_EQUAL_STRING("?T,25.00", replies[1].resp.c_str());  // no el 1413 tardío
+  TEST_ASSERT_EQUAL(EZO_OK, replies[2].status);
+  TEST_ASSERT_EQUAL_STRING("1413", replies[2].resp.c_str());      // no el *OK del T,?
+  TEST_ASSERT_FALSE(link.busy());
+}
+
+static void test_noise_bytes_are_filtered() {
+  EzoSim ezo;
+  ezo.cfg.noisePct = 100;
+  EzoUartTransport port(ezo);
+  EzoLink link(port);
+  for (int i = 0; i < 10; i++) {
+    TEST_ASSERT_TRUE(link.submit("R", EZO_TIMEOUT_AUTO, record));
+    run(link, 1000);
+  }
+  TEST_ASSERT_EQUAL(10, replies.size());
+  for (const Reply& r : replies) TEST_ASSERT_EQUAL_STRING("1413", r.resp.c_str());
+}
+
+static void noteCache(EzoLink&, EzoStatus status, const char* cmd, const char* resp, uint8_t len, void* ctx) {
+  static_cast<EzoQueryCache*>(ctx)->note(cmd, status, resp, len, millis());
+}
+
+static void test_query_cache_fills_and_invalidates() {
+  EzoSim ezo;
+  EzoUartTransport port(ezo);
+  EzoLink link(port);
+  EzoQueryCache cache;
+  link.setObserver(noteCache, &cache);
+  TEST_ASSERT_NULL(cache.lookup("Cal,?", millis()));
+  TEST_ASSERT_TRUE(link.submit("Cal,?", EZO_TIMEOUT_AUTO));
+  TEST_ASSERT_TRUE(link.submit("I", EZO_TIMEOUT_AUTO));
+  run(link, 1000);
+  TEST_ASSERT_EQUAL_STRING("?Cal,2", cache.lookup("Cal,?", millis()));
+  TEST_ASSERT_EQUAL_STRING("?I,EC,2.16", cache.lookup("i", millis()));
+  TEST_ASSERT_NULL(cache.lookup("R", millis()));   // las lecturas no se guardan
+
+  TEST_ASSERT_TRUE(link.submit("Cal,mid,1413", EZO_TIMEOUT_AUTO));
+  run(link, 1500);
+  TEST_ASSERT_NULL(cache.lookup("Cal,?", millis()));
+  TEST_ASSERT_NOT_NULL(cache.lookup("I", millis()));
+  TEST_ASSERT_TRUE(link.submit("Factory", EZO_TIMEOUT_AUTO));
+  run(link, 1500);
+  TEST_ASSERT_NULL(cache.lookup("I", millis()));
+}
+
+static void test_health_backs_off_and_reconfigures() {
+  EzoHealth h;
+  for (int i = 0; i < EZO_DOWN_AFTER; i++) {
+    TEST_ASSERT_TRUE(h.allow(0));
+    h.noteReply(EZO_TIMEOUT, 0);
+  }
+  TEST_ASSERT_EQUAL(EZO_HEALTH_DOWN, h.state());
+  // con la sonda caída solo sale un sondeo por espera, y la espera se duplica
+  TEST_ASSERT_FALSE(h.allow(0));
+  TEST_ASSERT_FALSE(h.allow(999));
+  TEST_ASSERT_TRUE(h.allow(1000));
+  TEST_ASSERT_FALSE(h.allow(1001));
+  TEST_ASSERT_EQUAL(2000, h.backoffMs());
+  TEST_ASSERT_TRUE(h.allow(3000));
+  TEST_ASSERT_FALSE(h.takeReconfigure());
+  h.noteReply(EZO_OK, 4);   // vuelve a contestar: se reconfigura una vez
+  TEST_ASSERT_EQUAL(EZO_HEALTH_OK, h.state());
+  TEST_ASSERT_TRUE(h.takeReconfigure());
+  TEST_ASSERT_FALSE(h.takeReconfigure());
+
+  h.noteLine("*RS", 3);
+  TEST_ASSERT_FALSE(h.takeReconfigure());   // espera a *RE
+  h.noteLine("*RE", 3);
+  TEST_ASSERT_TRUE(h.takeReconfigure());
+  h.noteLine("*UV", 3);
+  TEST_ASSERT_EQUAL(EZO_HEALTH_DEGRADED, h.state());
+  TEST_ASSERT_EQUAL_UINT32(1, h.resets());
+  TEST_ASSERT_EQUAL_UINT32(1, h.underVolt());
+  TEST_ASSERT_EQUAL_UINT32(EZO_DOWN_AFTER, h.timeouts());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_data_reply_then_ok_is_consumed);
+  RUN_TEST(test_continuous_mode_is_stopped_before_queries);
+  RUN_TEST(test_error_code_ends_transaction);
+  RUN_TEST(test_adaptive_timeout_fails_fast_when_disconnected);
+  RUN_TEST(test_late_reply_after_timeout_is_drained);
+  RUN_TEST(test_noise_bytes_are_filtered);
+  RUN_TEST(test_query_cache_fills_and_invalidates);
+  RUN_TEST(test_health_backs_off_and_reconfigures);
+  return UNITY_END();
+}
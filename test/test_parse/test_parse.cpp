@@ -0,0 +1,61 @@
+// Parser de lecturas del EZO (ezo_parse.h): formatos aceptados y rechazos
+#include <unity.h>
+#include <string.h>
+#include "ezo_parse.h"
+
+static uint8_t parse(const char* s, EcReading& rd) {
+  return ezoParseLine(s, (uint8_t)strlen(s), rd);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_unlabelled_ec_only() {
+  EcReading rd;
+  TEST_ASSERT_EQUAL_UINT8(EC_FIELD_EC, parse("1413.25", rd));
+  TEST_ASSERT_EQUAL_INT32(1413250, ecToMilli(rd.ec));
+}
+
+static void test_unlabelled_all_fields() {
+  EcReading rd;
+  TEST_ASSERT_EQUAL_UINT8(EC_FIELD_EC | EC_FIELD_TDS | EC_FIELD_SAL | EC_FIELD_SG, parse("1413,763,0.70,1.000", rd));
+  TEST_ASSERT_EQUAL_INT32(763000, ecToMilli(rd.tds));
+  TEST_ASSERT_EQUAL_INT32(700, ecToMilli(rd.sal));
+  TEST_ASSERT_EQUAL_INT32(1000, ecToMilli(rd.sg));
+}
+
+static void test_labelled_subset() {
+  EcReading rd;
+  TEST_ASSERT_EQUAL_UINT8(EC_FIELD_EC | EC_FIELD_SG, parse("EC,84.0,SG,1.000", rd));
+  TEST_ASSERT_EQUAL_INT32(84000, ecToMilli(rd.ec));
+  TEST_ASSERT_EQUAL_INT32(0, ecToMilli(rd.tds));
+}
+
+static void test_rejects_codes_queries_and_garbage() {
+  EcReading rd;
+  TEST_ASSERT_EQUAL_UINT8(0, parse("*OK", rd));
+  TEST_ASSERT_EQUAL_UINT8(0, parse("*ER", rd));
+  TEST_ASSERT_EQUAL_UINT8(0, parse("?K,1.0", rd));
+  TEST_ASSERT_EQUAL_UINT8(0, parse("", rd));
+  TEST_ASSERT_EQUAL_UINT8(0, parse("14x3", rd));
+  TEST_ASSERT_EQUAL_UINT8(0, parse("1413,763", rd));   // ni 1 ni 4 valores
+  TEST_ASSERT_EQUAL_UINT8(0, parse("TDS,763", rd));    // falta EC
+}
+
+static void test_parse_value() {
+  ec_value_t v;
+  TEST_ASSERT_TRUE(ezoParseValue("-1.5", 4, v));
+  TEST_ASSERT_EQUAL_INT32(-1500, ecToMilli(v));
+  TEST_ASSERT_FALSE(ezoParseValue("1.5.", 4, v));
+  TEST_ASSERT_FALSE(ezoParseValue("", 0, v));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_unlabelled_ec_only);
+  RUN_TEST(test_unlabelled_all_fields);
+  RUN_TEST(test_labelled_subset);
+  RUN_TEST(test_rejects_codes_queries_and_garbage);
+  RUN_TEST(test_parse_value);
+  return UNITY_END();
+}
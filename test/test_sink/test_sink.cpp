@@ -0,0 +1,83 @@
+// Envío por lotes sobre el buffer de muestras (sample_sink.h)
+#include <unity.h>
+#include <string.h>
+#include "sample_sink.h"
+#include "ec_frame.h"
+
+void setUp() {}
+void tearDown() {}
+
+static uint16_t seq = 0;
+
+static void fill(SampleRing<8>& ring, int n) {
+  for (int i = 0; i < n; i++, seq++) ring.push(seq, 1000u + seq, 1413000 + seq, 0);
+}
+
+static void test_waits_for_full_batch_or_flush() {
+  SampleRing<8> ring;
+  SampleBatcher b;
+  b.configure(4, 1000, SINK_BIN);
+  uint8_t pkt[128];
+  uint16_t len = 0;
+  seq = 0;
+  fill(ring, 3);
+  TEST_ASSERT_EQUAL(0, b.build(ring, 0, pkt, sizeof(pkt), len));
+  TEST_ASSERT_EQUAL(0, b.build(ring, 999, pkt, sizeof(pkt), len));
+  TEST_ASSERT_EQUAL(3, b.build(ring, 1000, pkt, sizeof(pkt), len));   // vence el intervalo
+  b.commit(3, true, 1000);
+  fill(ring, 4);
+  TEST_ASSERT_EQUAL(4, b.build(ring, 1001, pkt, sizeof(pkt), len));   // lote completo
+  TEST_ASSERT_EQUAL(SINK_HEADER_LEN + 4 * EC_FRAME_LEN, len);
+  TEST_ASSERT_EQUAL_HEX8(SINK_PACKET_SYNC, pkt[0]);
+  TEST_ASSERT_EQUAL(4, pkt[1]);
+  TEST_ASSERT_EQUAL(3, pkt[SINK_HEADER_LEN + 1]);   // primera secuencia del lote
+  b.commit(4, true, 1001);
+  TEST_ASSERT_EQUAL_UINT32(7, b.sent());
+  TEST_ASSERT_EQUAL_UINT32(2, b.packets());
+}
+
+static void test_failed_publish_keeps_samples_and_counts_overwrites() {
+  SampleRing<8> ring;
+  SampleBatcher b;
+  b.configure(4, 100, SINK_BIN);
+  uint8_t pkt[128];
+  uint16_t len = 0;
+  seq = 0;
+  fill(ring, 4);
+  TEST_ASSERT_EQUAL(4, b.build(ring, 0, pkt, sizeof(pkt), len));
+  b.commit(4, false, 0);                        // el destino no aceptó
+  fill(ring, 6);                                // buffer de 8: se pisan 2
+  // lote lleno, pero no se reintenta hasta pasado flushMs
+  TEST_ASSERT_EQUAL(0, b.build(ring, 1, pkt, sizeof(pkt), len));
+  TEST_ASSERT_EQUAL(0, b.build(ring, 99, pkt, sizeof(pkt), len));
+  TEST_ASSERT_EQUAL(4, b.build(ring, 100, pkt, sizeof(pkt), len));
+  TEST_ASSERT_EQUAL(2, pkt[SINK_HEADER_LEN + 1]);   // reintenta desde la más antigua que queda
+  TEST_ASSERT_EQUAL(2, pkt[2]);                 // perdidas en la cabecera
+  TEST_ASSERT_EQUAL_UINT32(2, b.dropped());
+  TEST_ASSERT_EQUAL_UINT32(1, b.failures());
+}
+
+static void test_json_and_capacity() {
+  SampleRing<8> ring;
+  SampleBatcher b;
+  b.configure(8, 100, SINK_JSON);
+  char pkt[256];
+  uint16_t len = 0;
+  seq = 0;
+  fill(ring, 2);
+  TEST_ASSERT_EQUAL(0, b.build(ring, 0, (uint8_t*)pkt, sizeof(pkt), len));
+  TEST_ASSERT_EQUAL(2, b.build(ring, 100, (uint8_t*)pkt, sizeof(pkt), len));
+  pkt[len] = '\0';
+  TEST_ASSERT_EQUAL_STRING("{\"drop\":0,\"s\":[[0,1000,0,1413000],[1,1001,0,1413001]],\"n\":2}", pkt);
+  fill(ring, 6);
+  // en 80 bytes solo cabe una muestra con el margen del peor caso
+  TEST_ASSERT_EQUAL(1, b.build(ring, 100, (uint8_t*)pkt, 80, len));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_waits_for_full_batch_or_flush);
+  RUN_TEST(test_failed_publish_keeps_samples_and_counts_overwrites);
+  RUN_TEST(test_json_and_capacity);
+  return UNITY_END();
+}
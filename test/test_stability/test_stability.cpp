@@ -0,0 +1,55 @@
+// Detector de lectura estable de la calibración guiada (ec_stability.h)
+#include <unity.h>
+#include "ec_stability.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_needs_full_window() {
+  EcStability s;
+  s.configure(5, 5, 1000);
+  for (int i = 0; i < 4; i++) TEST_ASSERT_FALSE(s.push(1413000));
+  TEST_ASSERT_TRUE(s.push(1413000));
+}
+
+static void test_drift_blocks_until_settled() {
+  EcStability s;
+  s.configure(8, 5, 1000);   // 0.5 % de 1413 ≈ 7 µS/cm
+  // la sonda se está termalizando: sube 3 µS/cm por lectura
+  int32_t x = 1380000;
+  for (int i = 0; i < 12; i++, x += 3000) TEST_ASSERT_FALSE(s.push(x));
+  TEST_ASSERT_INT32_WITHIN(1000, 21000, s.driftMilli());
+  // se asienta con ruido de ±1 µS/cm
+  bool stable = false;
+  for (int i = 0; i < 8; i++) stable = s.push(1413000 + ((i & 1) ? 1000 : -1000));
+  TEST_ASSERT_TRUE(stable);
+  TEST_ASSERT_INT32_WITHIN(s.toleranceMilli(), 0, s.driftMilli());
+}
+
+static void test_noise_above_tolerance_is_not_stable() {
+  EcStability s;
+  s.configure(6, 5, 1000);
+  bool stable = false;
+  for (int i = 0; i < 12; i++) stable = s.push(84000 + ((i & 1) ? 3000 : -3000));
+  TEST_ASSERT_FALSE(stable);
+  TEST_ASSERT_INT32_WITHIN(100, 3000, s.sigmaMilli());
+}
+
+static void test_floor_applies_near_zero() {
+  EcStability s;
+  s.configure(4, 5, 1000);   // en seco: tolerancia absoluta de 1 µS/cm
+  const int32_t in[] = { 200, -300, 100, 0 };
+  bool stable = false;
+  for (int32_t x : in) stable = s.push(x);
+  TEST_ASSERT_TRUE(stable);
+  TEST_ASSERT_EQUAL_INT32(1000, s.toleranceMilli());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_needs_full_window);
+  RUN_TEST(test_drift_blocks_until_settled);
+  RUN_TEST(test_noise_above_tolerance_is_not_stable);
+  RUN_TEST(test_floor_applies_near_zero);
+  return UNITY_END();
+}
@@ -0,0 +1,540 @@
+#!/usr/bin/env python3
+"""
+Banco de pruebas de extremo a extremo y prueba de larga duración (soak)
+contra el firmware real, por el puerto USB. Maneja la CLI, decodifica los
+registros binarios de muestra (ec_frame.h, 0xA7) y de perf (perf.h, 0xA9),
+y da ritmo sostenido, percentiles de latencia y tasa de pérdidas.
+
+  pip install pyserial
+  python3 tools/bench.py -p /dev/ttyACM0 run --mode polled --fmt bin --seconds 300
+  python3 tools/bench.py -p /dev/ttyACM0 matrix --seconds 120 --periods 1000,800,600
+  python3 tools/bench.py -p /dev/ttyACM0 soak --hours 8 --report 300 --log soak.csv
+
+Modos: "polled" (R cada --period ms, stream on) y "continuous" (C,n del EZO).
+UART frente a I2C es cosa del firmware: graba env:uno o env:uno_i2c y usa
+--label para distinguir los resultados. Ojo: la CLI guarda en EEPROM lo que
+cambia (fmt, period, filter, stream...), así que la placa queda en la
+configuración de la prueba.
+
+Código de salida: 0 si se cumplen los criterios (--max-drop, --ram-slack, sin
+reinicios ni registros corruptos), 1 si no; sirve como prueba de aceptación.
+"""
+import argparse
+import json
+import re
+import struct
+import sys
+import time
+
+EC_FRAME_SYNC = 0xA7
+EC_FRAME_LEN = 15
+PERF_FRAME_SYNC = 0xA9
+PERF_TIMERS = ("rtt", "parse", "print", "loop")
+PERF_COUNTERS = ("missed", "timeout", "parse_fail", "dropped")
+PERF_FRAME_LEN = 1 + 4 + len(PERF_TIMERS) * 16 + len(PERF_COUNTERS) * 4 + 4 + 1
+
+TEXT_SAMPLE = re.compile(r"^\[Lectura(?: (\d+))?\] Interpretación #(\d+) \(t=(\d+) ms, rtt=(\d+) ms\)")
+CSV_SAMPLE = re.compile(r"^(\d+),(\d+),(\d+),(\d+),(-?\d+(?:\.\d+)?)")
+TEXT_PERF = re.compile(r"^\[Perf\] (\w+): n=(\d+)(?: min=(\d+) max=(\d+) media=(\d+))?")
+TEXT_COUNTER = re.compile(r"^\[Perf\] ([^:]+): (\d+)$")
+TEXT_RAM = re.compile(r"^\[Perf\] RAM libre mín\.: (\d+)")
+COUNTER_TEXT = {"plazos perdidos": "missed", "timeouts": "timeout",
+                "no interpretables": "parse_fail", "perdidas (continuo)": "dropped"}
+
+
+def crc8(data):
+    """CRC-8 de crc8.h: polinomio 0x07, valor inicial 0."""
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+class Sample(object):
+    __slots__ = ("probe", "seq", "ms", "rtt", "ec", "host")
+
+    def __init__(self, probe, seq, ms, rtt, ec, host):
+        self.probe, self.seq, self.ms, self.rtt, self.ec, self.host = probe, seq, ms, rtt, ec, host
+
+
+class Perf(object):
+    """Un informe de perf; ms es None si llegó en texto (sin millis)."""
+
+    def __init__(self, host):
+        self.host = host
+        self.ms = None
+        self.timers = {}
+        self.counters = {}
+        self.ram_min = None
+
+
+def decode_sample(buf, host):
+    seq, ms, ec, rtt, flags = struct.unpack_from("<HIiHB", buf, 1)
+    return Sample(flags >> 4, seq, ms, rtt, ec / 1000.0, host)
+
+
+def decode_perf(buf, host):
+    p = Perf(host)
+    p.ms = struct.unpack_from("<I", buf, 1)[0]
+    off = 5
+    for name in PERF_TIMERS:
+        n, mn, mx, mean = struct.unpack_from("<IIII", buf, off)
+        p.timers[name] = (n, mn, mx, mean)
+        off += 16
+    for name in PERF_COUNTERS:
+        p.counters[name] = struct.unpack_from("<I", buf, off)[0]
+        off += 4
+    p.ram_min = struct.unpack_from("<I", buf, off)[0]
+    return p
+
+
+class StreamParser(object):
+    """
+    Separa el flujo del puerto en muestras, informes de perf y líneas de
+    texto. Los registros binarios solo pueden empezar en un límite (tras un
+    salto de línea o tras otro registro): ninguna línea de texto empieza por
+    0xA7/0xA9, aunque esos bytes sí aparecen dentro de UTF-8 ("é", "Ω").
+    """
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.bad_frames = 0
+        self.resync = False
+        self.text_perf = None
+
+    def feed(self, data, host):
+        self.buf += data
+        out = []
+        while self.buf:
+            b0 = self.buf[0]
+            if b0 in (EC_FRAME_SYNC, PERF_FRAME_SYNC):
+                n = EC_FRAME_LEN if b0 == EC_FRAME_SYNC else PERF_FRAME_LEN
+                if len(self.buf) < n:
+                    break
+                frame = bytes(self.buf[:n])
+                if crc8(frame[1:-1]) == frame[-1]:
+                    del self.buf[:n]
+                    self.resync = False
+                    out.append(decode_sample(frame, host) if b0 == EC_FRAME_SYNC else decode_perf(frame, host))
+                    continue
+                if not self.resync:
+                    self.bad_frames += 1
+                    self.resync = True
+                del self.buf[:1]
+                continue
+            if self.resync:
+                # Restos de un registro corrupto: se avanza byte a byte hasta
+                # un registro válido o el final de una línea
+                del self.buf[:1]
+                if b0 == 0x0A:
+                    self.resync = False
+                continue
+            nl = self.buf.find(b"\n")
+            if nl < 0:
+                break
+            line = bytes(self.buf[:nl]).decode("utf-8", "replace").rstrip("\r")
+            del self.buf[:nl + 1]
+            out.extend(self._text(line, host))
+        return out
+
+    def _text(self, line, host):
+        m = TEXT_SAMPLE.match(line)
+        if m:
+            return [Sample(int(m.group(1) or 0), int(m.group(2)), int(m.group(3)), int(m.group(4)), None, host)]
+        m = CSV_SAMPLE.match(line)
+        if m:
+            return [Sample(int(m.group(1)), int(m.group(2)), int(m.group(3)), int(m.group(4)),
+                           float(m.group(5)), host)]
+        # perf en texto: se acumula hasta la línea de RAM, que es la última
+        if line.startswith("[Perf] "):
+            if self.text_perf is None:
+                self.text_perf = Perf(host)
+            p = self.text_perf
+            m = TEXT_RAM.match(line)
+            if m:
+                p.ram_min = int(m.group(1))
+                self.text_perf = None
+                return [p]
+            m = TEXT_PERF.match(line)
+            if m and m.group(1) in PERF_TIMERS:
+                n = int(m.group(2))
+                p.timers[m.group(1)] = (n, int(m.group(3) or 0), int(m.group(4) or 0), int(m.group(5) or 0))
+                return []
+            m = TEXT_COUNTER.match(line)
+            if m and m.group(1) in COUNTER_TEXT:
+                p.counters[COUNTER_TEXT[m.group(1)]] = int(m.group(2))
+            return []
+        return [line]
+
+
+def percentile(values, q):
+    if not values:
+        return None
+    v = sorted(values)
+    k = (len(v) - 1) * q / 100.0
+    i = int(k)
+    j = min(i + 1, len(v) - 1)
+    return v[i] + (v[j] - v[i]) * (k - i)
+
+
+class Stats(object):
+    """Acumula muestras e informes de perf de un tramo de la prueba."""
+
+    def __init__(self):
+        self.samples = 0
+        self.gaps = 0
+        self.rtts = []
+        self.intervals = []
+        self.arrivals = []
+        self.last_seq = None
+        self.last_ms = {}
+        self.last_host = None
+        self.first_host = None
+        self.perf_last = None
+        self.counter_base = dict.fromkeys(PERF_COUNTERS, 0)
+        self.resets = 0
+        self.ram_min = None
+        self.ram_first = None
+        self.text_lines = 0
+
+    def add(self, ev):
+        if isinstance(ev, Sample):
+            self._sample(ev)
+        elif isinstance(ev, Perf):
+            self._perf(ev)
+        else:
+            self.text_lines += 1
+
+    def _sample(self, s):
+        self.samples += 1
+        if self.first_host is None:
+            self.first_host = s.host
+        # la secuencia es común a todas las sondas y da la vuelta a 65536
+        if self.last_seq is not None:
+            self.gaps += (s.seq - self.last_seq - 1) & 0xFFFF
+        self.last_seq = s.seq
+        if s.rtt:
+            self.rtts.append(s.rtt)
+        prev = self.last_ms.get(s.probe)
+        if prev is not None and s.ms >= prev:
+            self.intervals.append(s.ms - prev)
+        self.last_ms[s.probe] = s.ms
+        if self.last_host is not None:
+            self.arrivals.append((s.host - self.last_host) * 1000.0)
+        self.last_host = s.host
+
+    def _perf(self, p):
+        # los contadores empiezan en 0 con "perf reset" (setup_mode) y tras
+        # un reinicio de la placa, que se nota porque millis() retrocede
+        last = self.perf_last
+        if last is not None and p.ms is not None and last.ms is not None and p.ms < last.ms:
+            self.resets += 1
+            for name in PERF_COUNTERS:
+                self.counter_base[name] += last.counters.get(name, 0)
+            self.ram_first = None
+        self.perf_last = p
+        if p.ram_min is not None:
+            if self.ram_first is None:
+                self.ram_first = p.ram_min
+            self.ram_min = p.ram_min if self.ram_min is None else min(self.ram_min, p.ram_min)
+
+    def counter(self, name):
+        last = self.perf_last.counters.get(name, 0) if self.perf_last is not None else 0
+        return self.counter_base[name] + last
+
+    def elapsed(self):
+        if self.first_host is None or self.last_host is None:
+            return 0.0
+        return self.last_host - self.first_host
+
+    def rate(self):
+        t = self.elapsed()
+        return (self.samples - 1) / t if t > 0 and self.samples > 1 else 0.0
+
+    def drop_rate(self):
+        lost = self.gaps + self.counter("dropped")
+        total = self.samples + lost
+        return lost / float(total) if total else 0.0
+
+    def summary(self):
+        d = {
+            "samples": self.samples,
+            "seconds": round(self.elapsed(), 1),
+            "rate_hz": round(self.rate(), 3),
+            "seq_gaps": self.gaps,
+            "drop_rate": round(self.drop_rate(), 5),
+            "rtt_ms": pct_dict(self.rtts),
+            "interval_ms": pct_dict(self.intervals),
+            "arrival_ms": pct_dict(self.arrivals),
+            "resets": self.resets,
+            "ram_min": self.ram_min,
+        }
+        for name in PERF_COUNTERS:
+            d[name] = self.counter(name)
+        if self.perf_last is not None:
+            for name, (n, mn, mx, mean) in sorted(self.perf_last.timers.items()):
+                d["perf_" + name + "_us"] = {"n": n, "min": mn, "max": mx, "mean": mean}
+        return d
+
+
+def pct_dict(values):
+    if not values:
+        return None
+    return {"p50": percentile(values, 50), "p90": percentile(values, 90),
+            "p99": percentile(values, 99), "max": max(values)}
+
+
+class Device(object):
+    def __init__(self, port, baud, verbose):
+        import serial  # pyserial; solo hace falta con placa
+        self.ser = serial.Serial(port, baud, timeout=0.05)
+        self.parser = StreamParser()
+        self.verbose = verbose
+        time.sleep(2.0)   # el Uno se reinicia al abrir el puerto
+        self.ser.reset_input_buffer()
+
+    def events(self):
+        data = self.ser.read(4096)
+        if not data:
+            return []
+        return self.parser.feed(data, time.monotonic())
+
+    def command(self, line, wait=0.4, sink=None):
+        """Envía una línea a la CLI y consume lo que llegue durante wait s."""
+        self.ser.write((line + "\n").encode("ascii"))
+        self.ser.flush()
+        end = time.monotonic() + wait
+        while time.monotonic() < end:
+            for ev in self.events():
+                if isinstance(ev, str):
+                    if self.verbose:
+                        print("  < " + ev)
+                elif sink is not None:
+                    sink.add(ev)
+
+    def collect(self, seconds, stats, on_tick=None, tick_s=None):
+        end = time.monotonic() + seconds
+        next_tick = time.monotonic() + tick_s if tick_s else None
+        while time.monotonic() < end:
+            for ev in self.events():
+                stats.add(ev)
+                if self.verbose and isinstance(ev, str):
+                    print("  < " + ev)
+            if next_tick is not None and time.monotonic() >= next_tick:
+                next_tick += tick_s
+                on_tick()
+
+
+def setup_mode(dev, args, mode, fmt, period_ms):
+    dev.command("bench off")
+    for i in range(args.probes):
+        if args.probes > 1:
+            dev.command("p %d" % i)
+        dev.command("stream off")
+        dev.command("c off", wait=1.0)
+    dev.command("fmt " + fmt)
+    dev.command("log err")
+    dev.command("filter off")
+    dev.command("avg 1")
+    if mode == "polled":
+        dev.command("period %d" % period_ms)
+    dev.command("perf reset")
+    for i in range(args.probes):
+        if args.probes > 1:
+            dev.command("p %d" % i)
+        if mode == "polled":
+            dev.command("stream on")
+        else:
+            dev.command("c %d" % args.cont_s, wait=1.0)
+    dev.command("bench %d" % args.bench_s)
+
+
+def teardown(dev, args):
+    dev.command("bench off")
+    for i in range(args.probes):
+        if args.probes > 1:
+            dev.command("p %d" % i)
+        dev.command("stream off")
+        dev.command("c off", wait=1.0)
+
+
+def run_one(dev, args, mode, fmt, period_ms, seconds):
+    expected = period_ms if mode == "polled" else args.cont_s * 1000
+    stats = Stats()
+    setup_mode(dev, args, mode, fmt, period_ms)
+    dev.collect(seconds, stats)
+    teardown(dev, args)
+    d = stats.summary()
+    d.update({"label": args.label, "mode": mode, "fmt": fmt, "period_ms": expected,
+              "bad_frames": dev.parser.bad_frames})
+    return stats, d
+
+
+def print_result(d):
+    print("[%s] %s/%s, %d ms: %d muestras en %.0f s = %.3f Hz, pérdidas %.3f %% (huecos %d, continuo %d)"
+          % (d["label"], d["mode"], d["fmt"], d["period_ms"], d["samples"], d["seconds"], d["rate_hz"],
+             d["drop_rate"] * 100.0, d["seq_gaps"], d["dropped"]))
+    print("  rtt ms:     " + fmt_pct(d["rtt_ms"]))
+    print("  periodo ms: " + fmt_pct(d["interval_ms"]))
+    print("  llegada ms: " + fmt_pct(d["arrival_ms"]))
+    print("  timeouts %d, plazos perdidos %d, no interpretables %d, registros corruptos %d, RAM libre mín. %s"
+          % (d["timeout"], d["missed"], d["parse_fail"], d["bad_frames"],
+             d["ram_min"] if d["ram_min"] is not None else "n/a"))
+
+
+def fmt_pct(p):
+    if not p:
+        return "n/a"
+    return "p50=%.0f p90=%.0f p99=%.0f max=%.0f" % (p["p50"], p["p90"], p["p99"], p["max"])
+
+
+def check(d, args):
+    """Criterios de aceptación; devuelve la lista de fallos."""
+    fails = []
+    if d["samples"] == 0:
+        fails.append("sin muestras")
+    if d["drop_rate"] > args.max_drop:
+        fails.append("pérdidas %.3f %% > %.3f %%" % (d["drop_rate"] * 100.0, args.max_drop * 100.0))
+    if d["resets"]:
+        fails.append("%d reinicios de la placa" % d["resets"])
+    if d["bad_frames"]:
+        fails.append("%d registros con CRC erróneo" % d["bad_frames"])
+    return fails
+
+
+def cmd_run(dev, args):
+    _, d = run_one(dev, args, args.mode, args.fmt, args.period, args.seconds)
+    print_result(d)
+    return [d]
+
+
+def cmd_matrix(dev, args):
+    results = []
+    periods = [int(p) for p in args.periods.split(",")]
+    for fmt in args.fmts.split(","):
+        for period in periods:
+            _, d = run_one(dev, args, "polled", fmt, period, args.seconds)
+            print_result(d)
+            results.append(d)
+        _, d = run_one(dev, args, "continuous", fmt, args.period, args.seconds)
+        print_result(d)
+        results.append(d)
+    print()
+    print("%-8s %-10s %-5s %7s %8s %8s %9s %9s" % ("label", "modo", "fmt", "ms", "Hz", "pérd.%", "rtt p50", "rtt p99"))
+    for d in results:
+        r = d["rtt_ms"] or {"p50": 0, "p99": 0}
+        print("%-8s %-10s %-5s %7d %8.3f %8.3f %9.0f %9.0f" % (
+            d["label"], d["mode"], d["fmt"], d["period_ms"], d["rate_hz"], d["drop_rate"] * 100.0,
+            r["p50"], r["p99"]))
+    return results
+
+
+def cmd_soak(dev, args):
+    stats = Stats()
+    setup_mode(dev, args, args.mode, args.fmt, args.period)
+    start = time.monotonic()
+    log = open(args.log, "w") if args.log else None
+    cols = ["elapsed_s", "samples", "rate_hz", "seq_gaps", "drop_rate"] + list(PERF_COUNTERS) + \
+        ["bad_frames", "resets", "ram_min", "rtt_p99"]
+    if log:
+        log.write(",".join(cols) + "\n")
+    state = {"last_perf": time.monotonic(), "seen": None, "stalls": 0}
+
+    def tick():
+        now = time.monotonic()
+        if stats.perf_last is not state["seen"]:
+            state["seen"] = stats.perf_last
+            state["last_perf"] = now
+        elif now - state["last_perf"] > 3 * args.bench_s:
+            state["stalls"] += 1   # la placa dejó de informar: colgada o reiniciada sin CLI
+            state["last_perf"] = now
+        d = stats.summary()
+        row = [round(now - start), d["samples"], d["rate_hz"], d["seq_gaps"], d["drop_rate"]] + \
+            [d[c] for c in PERF_COUNTERS] + [dev.parser.bad_frames, d["resets"], d["ram_min"],
+                                             (d["rtt_ms"] or {}).get("p99")]
+        print("[soak] " + " ".join("%s=%s" % (c, v) for c, v in zip(cols, row)))
+        if log:
+            log.write(",".join("" if v is None else str(v) for v in row) + "\n")
+            log.flush()
+
+    try:
+        dev.collect(args.hours * 3600.0, stats, tick, args.report)
+    except KeyboardInterrupt:
+        print("[soak] interrumpido")
+    teardown(dev, args)
+    if log:
+        log.close()
+    d = stats.summary()
+    d.update({"label": args.label, "mode": args.mode, "fmt": args.fmt, "period_ms": args.period,
+              "bad_frames": dev.parser.bad_frames, "stalls": state["stalls"],
+              "ram_first": stats.ram_first})
+    print_result(d)
+    return [d]
+
+
+def soak_checks(d, args):
+    fails = []
+    if d.get("stalls"):
+        fails.append("%d periodos sin informe de perf" % d["stalls"])
+    # la RAM libre mínima no debe seguir bajando tras el primer informe
+    if d.get("ram_first") is not None and d["ram_min"] is not None and d["ram_first"] - d["ram_min"] > args.ram_slack:
+        fails.append("RAM libre mín. bajó %d bytes (> %d)" % (d["ram_first"] - d["ram_min"], args.ram_slack))
+    return fails
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Banco de pruebas y soak del firmware EZO EC")
+    ap.add_argument("-p", "--port", required=True, help="puerto serie (p. ej. /dev/ttyACM0, COM3)")
+    ap.add_argument("-b", "--baud", type=int, default=115200)
+    ap.add_argument("--label", default="uart", help="etiqueta de los resultados (p. ej. uart, i2c)")
+    ap.add_argument("--probes", type=int, default=1, help="sondas (I2C con varias direcciones)")
+    ap.add_argument("--period", type=int, default=1000, help="periodo de R en modo polled, ms")
+    ap.add_argument("--cont-s", type=int, default=1, help="n de C,n en modo continuo, s")
+    ap.add_argument("--bench-s", type=int, default=10, help="periodo del informe de perf, s")
+    ap.add_argument("--max-drop", type=float, default=0.001, help="tasa de pérdidas admitida (0.001 = 0.1 %%)")
+    ap.add_argument("--ram-slack", type=int, default=16, help="bytes que puede bajar la RAM libre mín. en soak")
+    ap.add_argument("--json", help="guarda los resultados en este fichero")
+    ap.add_argument("-v", "--verbose", action="store_true", help="muestra las respuestas de la CLI")
+    sub = ap.add_subparsers(dest="cmd")
+
+    r = sub.add_parser("run", help="un modo durante --seconds")
+    r.add_argument("--mode", choices=("polled", "continuous"), default="polled")
+    r.add_argument("--fmt", choices=("text", "bin", "csv"), default="bin")
+    r.add_argument("--seconds", type=float, default=120)
+
+    m = sub.add_parser("matrix", help="polled (cada periodo) y continuo, en cada formato")
+    m.add_argument("--fmts", default="text,bin")
+    m.add_argument("--periods", default="1000,800,600", help="periodos de polled a barrer, ms")
+    m.add_argument("--seconds", type=float, default=120)
+
+    s = sub.add_parser("soak", help="prueba de horas con informe periódico")
+    s.add_argument("--mode", choices=("polled", "continuous"), default="polled")
+    s.add_argument("--fmt", choices=("text", "bin", "csv"), default="bin")
+    s.add_argument("--hours", type=float, default=8)
+    s.add_argument("--report", type=float, default=300, help="segundos entre líneas de informe")
+    s.add_argument("--log", help="CSV con una fila por informe")
+
+    args = ap.parse_args(argv)
+    if not args.cmd:
+        ap.error("falta el subcomando: run, matrix o soak")
+
+    dev = Device(args.port, args.baud, args.verbose)
+    results = {"run": cmd_run, "matrix": cmd_matrix, "soak": cmd_soak}[args.cmd](dev, args)
+
+    fails = []
+    for d in results:
+        for f in check(d, args) + (soak_checks(d, args) if args.cmd == "soak" else []):
+            fails.append("%s/%s/%d ms: %s" % (d["mode"], d["fmt"], d["period_ms"], f))
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"results": results, "failures": fails}, f, indent=2, ensure_ascii=False)
+    for f in fails:
+        print("FALLO " + f)
+    print("OK" if not fails else "NO APTO")
+    return 1 if fails else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
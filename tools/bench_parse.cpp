@@ -0,0 +1,149 @@
+/*
+ * Microbenchmark en el host: parseEcLine (String + indexOf + substring)
+ * frente a ezoParseLine (una pasada, sin heap).
+ *
+ *   g++ -O2 -std=gnu++11 -Ilib/EzoEc/src tools/bench_parse.cpp lib/EzoEc/src/ezo_parse.cpp -o bench_parse
+ *   ./bench_parse
+ *
+ * Añade -DEC_FIXED_POINT=0 para medir el parser en modo float.
+ *
+ * El parser antiguo se reproduce aquí sobre std::string con el mismo patrón
+ * de copias y asignaciones que tenía sobre String de Arduino.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+#include "ezo_parse.h"
+
+namespace legacy {
+
+void trim(std::string& s) {
+  size_t a = s.find_first_not_of(" \t\r\n");
+  if (a == std::string::npos) { s.clear(); return; }
+  size_t b = s.find_last_not_of(" \t\r\n");
+  s = s.substr(a, b - a + 1);
+}
+
+int indexOf(const std::string& s, char c, size_t from = 0) {
+  size_t p = s.find(c, from);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+std::string sub(const std::string& s, size_t a, size_t b = std::string::npos) {
+  if (a >= s.size()) return std::string();
+  return s.substr(a, b == std::string::npos ? b : b - a);
+}
+
+float toFloat(const std::string& s) { return (float)atof(s.c_str()); }
+
+bool parseEcLine(const std::string& line, float& ec, float& tds, float& sal, float& sg) {
+  std::string s = line; trim(s);
+  if (s.length() == 0) return false;
+  if (s.rfind("*OK", 0) == 0) return false;
+  if (s.find("EC") != std::string::npos || s.find("TDS") != std::string::npos ||
+      s.find("SAL") != std::string::npos || s.find("SG") != std::string::npos) {
+    float lec = 0, ltds = 0, lsal = 0, lsg = 0; size_t pos = 0; bool ecFound = false;
+    while (pos < s.length()) {
+      int c = indexOf(s, ',', pos);
+      std::string tok = (c == -1) ? sub(s, pos) : sub(s, pos, c); trim(tok);
+      pos = (c == -1) ? s.length() : c + 1;
+      if (tok == "EC" || tok == "TDS" || tok == "SAL" || tok == "SG") {
+        int c2 = indexOf(s, ',', pos);
+        std::string val = (c2 == -1) ? sub(s, pos) : sub(s, pos, c2); trim(val);
+        float f = toFloat(val);
+        if (tok == "EC") { lec = f; ecFound = true; }
+        else if (tok == "TDS") ltds = f;
+        else if (tok == "SAL") lsal = f;
+        else lsg = f;
+        pos = (c2 == -1) ? s.length() : c2 + 1;
+      }
+    }
+    if (ecFound) { ec = lec; tds = ltds; sal = lsal; sg = lsg; return true; }
+    return false;
+  }
+  int p1 = indexOf(s, ',');
+  if (p1 == -1) { ec = toFloat(s); tds = 0; sal = 0; sg = 0; return true; }
+  int p2 = indexOf(s, ',', p1 + 1); if (p2 == -1) return false;
+  int p3 = indexOf(s, ',', p2 + 1); if (p3 == -1) return false;
+  ec = toFloat(sub(s, 0, p1)); tds = toFloat(sub(s, p1 + 1, p2));
+  sal = toFloat(sub(s, p2 + 1, p3)); sg = toFloat(sub(s, p3 + 1));
+  return true;
+}
+
+}  // namespace legacy
+
+static const char* const LINES[] = {
+  "0.00",
+  "1413",
+  "12880.5",
+  "1413,707,0.70,1.000",
+  "EC,1413,TDS,707,SAL,0.70,SG,1.000",
+  "EC,0.54",
+  "*OK",
+};
+static const int NLINES = sizeof(LINES) / sizeof(LINES[0]);
+
+static inline uint64_t ticks() {
+#ifdef HAVE_RDTSC
+  return __rdtsc();
+#else
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static volatile float sink;
+
+int main(int argc, char** argv) {
+  const long iters = (argc > 1) ? atol(argv[1]) : 200000;
+#ifdef HAVE_RDTSC
+  const char* unit = "ciclos";
+#else
+  const char* unit = "ns";
+#endif
+
+  // Ambos parsers deben coincidir en EC para las líneas válidas
+  for (int i = 0; i < NLINES; i++) {
+    float a = 0, b = 0, c = 0, d = 0;
+    EcReading r = { 0, 0, 0, 0 };
+    bool ok1 = legacy::parseEcLine(LINES[i], a, b, c, d);
+    uint8_t m = ezoParseLine(LINES[i], (uint8_t)strlen(LINES[i]), r);
+    if (ok1 != (m != 0) || (ok1 && fabsf(a - ecToFloat(r.ec)) > 1e-3f)) {
+      printf("discrepancia en \"%s\": legacy=%d/%g nuevo=0x%x/%g\n", LINES[i], ok1, a, m,
+             ecToFloat(r.ec));
+      return 1;
+    }
+  }
+
+  printf("%-40s %14s %14s\n", "linea", "parseEcLine", "ezoParseLine");
+  for (int i = 0; i < NLINES; i++) {
+    const char* l = LINES[i];
+    const std::string ls(l);
+    const uint8_t n = (uint8_t)strlen(l);
+    float a, b, c, d;
+    EcReading r;
+
+    uint64_t t0 = ticks();
+    for (long k = 0; k < iters; k++) {
+      legacy::parseEcLine(ls, a, b, c, d);
+      sink = a;
+    }
+    uint64_t t1 = ticks();
+    for (long k = 0; k < iters; k++) {
+      ezoParseLine(l, n, r);
+      sink = ecToFloat(r.ec);
+    }
+    uint64_t t2 = ticks();
+
+    printf("%-40s %10.1f %-3s %10.1f %-3s\n", l,
+           (double)(t1 - t0) / iters, unit, (double)(t2 - t1) / iters, unit);
+  }
+  return 0;
+}